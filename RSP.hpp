@@ -28,6 +28,14 @@ To link with the source of the functions, simply add the line
 To mute the code from printing outputs when an error ocours, simply add
 
 #define RSP_QUIET_ERRORS
+
+To load gzip (.gz) files, add this line and link with zlib (-lz)
+
+#define RSP_ZLIB
+
+To load zstd (.zst) files, add this line and link with libzstd (-lzstd)
+
+#define RSP_ZSTD
 */
 
 #pragma once // File doesn't repeat itself if it included again
@@ -36,6 +44,40 @@ To mute the code from printing outputs when an error ocours, simply add
 #include <vector> // std::vector
 #include <map> // std::map
 #include <algorithm> // algorithm functions, std::find, std::reverse, ect
+#include <string_view> // std::string_view
+#include <memory> // std::unique_ptr
+#include <cstring> // memchr
+#include <cstdlib> // strtol
+#include <cctype> // isxdigit
+#include <thread> // std::thread (loadMany)
+#include <future> // std::future, std::promise (loadMany)
+#include <atomic> // std::atomic (loadMany)
+#include <mutex> // std::mutex (stream)
+#include <condition_variable> // std::condition_variable (stream)
+#include <deque> // std::deque (stream)
+#include <cstdio> // FILE, fopen, fread
+#include <cstdint> // int64_t (table)
+#include <cerrno> // errno (table)
+#include <functional> // std::function (watcher)
+
+#ifdef RSP_ZLIB
+#include <zlib.h> // gzip decompression
+#endif
+
+#ifdef RSP_ZSTD
+#include <zstd.h> // zstd decompression
+#endif
+
+#ifdef __linux__
+#include <fcntl.h> // posix_fadvise (read-ahead)
+#include <unistd.h> // close
+#include <sys/inotify.h> // inotify (watcher)
+#include <poll.h> // poll (watcher)
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h> // SSE2 intrinsics (escape scanning)
+#endif
 
 namespace RSP {
   enum format {
@@ -46,6 +88,7 @@ namespace RSP {
     CSV_COMMA, // CSV using , as a divider
     CSV_SEMI, // CSV using ; as a divider
     CSV_GUESS, // CSV guess the divider
+    NDJSON, // newline delimited JSON, one JSON value per line
     GUESS // Tell the function to guess what format the data is
   }; // format of data, or let the library guess what the proper format is
 
@@ -72,6 +115,7 @@ namespace RSP {
 
     std::vector<data> next;                  // next data, if there is any
     std::map<std::string, std::string> args; // arguments (for this data index) (XML only)
+    bool quoted = false;                     // the value was a JSON string, so it's written quoted even if it looks like a number
 
     void push(std::string key, std::string value) { next.push_back({key, value}); } // push key/value to next
     void push(data d) { next.push_back(d); }                                        // push data object to next
@@ -83,19 +127,160 @@ namespace RSP {
     data &operator[](int index) { return list[index]; } // [] function for lists
   };                                                    // data format object (for user)
 
-  std::vector<std::string> voidTags; // void tags (for HTML)
+  struct arena {
+    std::vector<std::unique_ptr<char[]>> blocks; // storage blocks, never moved once allocated
+    size_t used = 0;                              // bytes used in the last block
+    size_t cap = 0;                               // size of the last block
+
+    char *alloc(size_t size); // get size bytes that live as long as the arena does
+  };                          // storage for decoded strings
+
+  struct stream {
+    stream(std::string file, size_t blockSize = 1 << 16); // open a file, decompressing it if it starts with gzip or zstd magic bytes
+    ~stream();
+
+    bool read(std::string &block); // get the next block of (decompressed) data, false once there's nothing left
+
+    bool failed = false; // true if the file couldn't be opened or decompressed
+    std::string error;   // what went wrong (if failed)
+    size_t size = 0;     // size of the file on disk
+
+    FILE *f = NULL;
+    size_t blockSize;
+    std::deque<std::string> blocks; // blocks that are decompressed, but not read yet
+    bool done = false, stop = false;
+    std::mutex lock;
+    std::condition_variable wait;
+    std::thread worker; // reads and decompresses blocks ahead of read()
+  }; // block by block file input, decompression runs on its own thread
+
+  std::vector<std::string> voidTags; // void tags (for XML/SVG, HTML always uses HTML's void tags)
+
+  // escapes (JSON) and entities (XML, HTML, SVG)
+  bool hasEscapes(std::string_view str, format c);                // SIMD check for \ (JSON) or & (XML)
+  std::string_view unescape(std::string_view str, format c, arena &a, bool quoted = true); // strip quotes (if quoted) and decode, returns a view of str if there is nothing to decode
+  std::string escape(std::string_view str, format c);             // escape a string for writing (without quotes)
+
+  data loadF(std::string file, format c = GUESS, bool validate = false, unsigned int threads = 1); // load data from file
+  data loadS(std::string data, format c = GUESS, bool validate = false, unsigned int threads = 1); // load data from string (validate : check JSON/XML is well-formed while tokenizing, threads : parse XML with parseXMLParallel if not 1, unless validating)
+
+  struct detection {
+    format c;          // the format it's most likely to be (GUESS if there's nothing to go on)
+    float confidence;  // 0 - 1, how sure the guess is
+  }; // result of detect
+
+  detection detect(std::string_view data, size_t limit = 4096); // guess data's format, only looking at the first limit bytes
+
+  struct loader {
+    std::vector<std::future<data>> files; // a future for each file, in the same order as the files
+    std::vector<std::thread> threads;     // the pool loading them
+
+    loader() = default;
+    loader(loader &&) = default;
+    loader &operator=(loader &&other); // waits for the pool it had, then takes other's
+    ~loader();                         // waits for the pool to finish
 
-  data loadF(std::string file, format c = GUESS); // load data from file
-  data loadS(std::string data, format c = GUESS); // load data from string
+    std::future<data> &operator[](int index) { return files[index]; }
+  }; // files being loaded by loadManyAsync
+
+  // load many files at once on a pool of threads (threads = 0 uses one per core)
+  std::vector<data> loadMany(std::vector<std::string> files, format c = GUESS, unsigned int threads = 0); // results are in the same order as files
+  loader loadManyAsync(std::vector<std::string> files, format c = GUESS, unsigned int threads = 0);      // take each file as it's done
 
   void dumpF(std::string file, data d, format c); // dump data into a file
   std::string dumpF(data d, format);              // dump data into a string
 
+  // CSS selector style queries for XML/HTML/SVG trees (tag, *, #id, .class, [attr], [attr=value], descendant ' ' and child '>', groups with ',')
+  struct nodeIndex {
+    std::vector<data *> nodes;                          // every node, in document order
+    std::map<data *, data *> parents;                   // node -> parent node
+    std::map<data *, size_t> order;                     // node -> position in nodes
+    std::map<std::string, std::vector<data *>> tags;    // tag name -> nodes
+    std::map<std::string, std::vector<data *>> ids;     // id -> nodes (ids should be unique, but often aren't)
+    std::map<std::string, std::vector<data *>> classes; // class -> nodes
+  }; // index of a tree, it holds pointers into the tree, so rebuild it if the tree changes
+
+  nodeIndex buildIndex(data &root);                               // index a tree in one pass
+  std::vector<data *> select(data &root, std::string selector);   // find the matching nodes by walking the tree
+  std::vector<data *> select(nodeIndex &idx, std::string selector); // find the matching nodes using an index
+
+  enum changeType {
+    added,   // node is new
+    removed, // node is gone
+    changed  // node's value, args or list changed
+  }; // types of changes between two trees
+
+  struct change {
+    changeType t;     // type
+    std::string path; // keys from the root to the node, split by '/' (repeated keys get [n], ex. "body/p[2]")
+  }; // a change between two trees
+
+  std::vector<change> diff(data &a, data &b); // get the changes that turn a into b
+
+  struct watcher {
+    watcher(std::string file, format c = GUESS); // load a file and start watching it
+    watcher(const watcher &) = delete;
+    ~watcher();
+
+    bool poll(int timeout = 0); // wait up to timeout ms (-1 for forever) for the file to change, returns true if the tree changed
+    void subscribe(std::string path, std::function<void(const change &)> f); // call f for changes at, under or above path ("" for every change)
+
+    data tree;    // the current tree, unchanged nodes are kept (not reallocated) when the file is reloaded
+    std::string file;
+    format c;
+    unsigned long long hash = 0; // hash of the file's contents
+    std::vector<std::pair<std::string, std::function<void(const change &)>>> subscribers;
+    int fd = -1, wd = -1; // inotify handles (linux)
+  }; // reloads a file when its contents change
+
+  // streaming conversion, converts from JSON, NDJSON, XML, HTML, SVG or CSV to JSON, NDJSON or XML without building a tree
+  // from XML, args become "@arg" keys and text becomes "#text", elements with children go in lists (so siblings with the same name share one), leaves only when they repeat
+  // siblings are only grouped when they're next to each other, <r><a/><b/><a/></r> gives two "a" keys (grouping them would mean holding the whole element back)
+  bool transcode(std::string in, std::string out, format from = GUESS, format to = GUESS);                  // file to file, GUESS uses the file extensions
+  bool transcode(stream &in, format from, std::function<void(const std::string &)> out, format to);         // stream to a function that gets the output piece by piece
+
+  enum columnType {
+    intColumn,    // int64_t
+    doubleColumn, // double
+    boolColumn,   // bool (true/false)
+    stringColumn  // strings, stored back to back
+  }; // types of table columns
+
+  struct column {
+    std::string name;              // name (from the CSV header)
+    columnType t = intColumn;      // type (guessed from the first rows)
+
+    std::vector<int64_t> ints;     // values (intColumn)
+    std::vector<double> doubles;   // values (doubleColumn)
+    std::vector<bool> bools;       // values (boolColumn)
+    std::string chars;             // every string, back to back (stringColumn, every column keeps its text while loading, in case it has to become one)
+    std::vector<size_t> offsets;   // where each string starts in chars, plus where the last one ends (stringColumn)
+    std::vector<bool> nulls;       // true for empty cells
+
+    size_t size() { return nulls.size(); }                                                      // number of rows
+    std::string_view str(size_t row) { return std::string_view(chars).substr(offsets[row], offsets[row + 1] - offsets[row]); } // string at row (stringColumn)
+  };  // one column of a table, a single typed buffer
+
+  struct table {
+    std::vector<column> columns; // the columns
+    size_t rows = 0;             // number of rows
+
+    bool failed = false; // true if the file couldn't be read (the rows read before that are kept)
+    std::string error;   // what went wrong (if failed)
+
+    column &operator[](std::string name); // get a column by name
+    column &operator[](int index) { return columns[index]; }
+  }; // CSV data stored by column (instead of as a data object per row)
+
+  table loadTableF(std::string file, format c = CSV_GUESS, size_t sample = 1000); // load a CSV file as a table, column types are guessed from the first sample rows
+  table loadTableS(std::string data, format c = CSV_GUESS, size_t sample = 1000); // load a CSV string as a table
+
   // these functions are run by the load functions
-  std::vector<token> tokenizeXML(std::string data, format c); // tokenize xml data
+  std::vector<token> tokenizeXML(std::string data, format c, std::string *error = NULL); // tokenize xml data (if error isn't NULL, check it's well-formed and write the first problem to it)
   data parseXML(std::vector<token> tokens, format c);         // parse xml tokens
+  data parseXMLParallel(std::string data, format c, unsigned int threads = 0); // tokenize and parse the root's children on a pool of threads (threads = 0 uses one per core)
 
-  std::vector<token> tokenizeJSON(std::string data); // tokenize json data
+  std::vector<token> tokenizeJSON(std::string data, std::string *error = NULL); // tokenize json data (if error isn't NULL, check it's well-formed and write the first problem to it)
   data parseJSON(std::vector<token> tokens);         // parse json data
 
   std::vector<token> tokenizeCSV(std::string data, format c = CSV_GUESS); // tokenize csv data
@@ -107,10 +292,10 @@ namespace RSP {
 RSP::data error = {"RSP-ERROR"}; // error data obj to output in case of errors
 
 RSP::data &RSP::data::operator[](std::string key) {        // [] function source
-  int i; // index
+  size_t i; // index
   for (i = 0; i < next.size() && next[i].key != key; i++); // find the index of the key
 
-  if (next[i].key != key) { // the key was not found
+  if (i >= next.size()) { // the key was not found
     #ifndef RSP_QUIET_ERRORS    
     printf("RSP::data :: Key not found \"%s\"\n", key.c_str()); // print error
     #endif /*RSP_QUIET_ERRORS*/
@@ -123,16 +308,343 @@ RSP::data &RSP::data::operator[](std::string key) {        // [] function source
   return next[i]; // return the srcs that holds the same key
 }
 
-std::vector<RSP::token> RSP::tokenizeXML(std::string data, format c){
-  if (c == HTML) // if we're using HTML, fill voidTags with HTML's void tags
-    voidTags = {"area", "base", "br", "col", "command", "embed", "hr", "img", "input", "keygen", "link", "meta", "param", "source", "track", "wbr"};
+char *RSP::arena::alloc(size_t size) {
+  if (blocks.empty() || used + size > cap) { // the current block is full, get a new one
+    cap = (size > 4096) ? size : 4096;
+    blocks.emplace_back(new char[cap]);
+    used = 0;
+  }
+
+  used += size;
+  return blocks.back().get() + used - size;
+}
+
+size_t RSPfind(const char *str, size_t len, char c) { // find c in str, 16 bytes at a time if we can
+  size_t i = 0;
+
+  #ifdef __SSE2__
+  const __m128i needle = _mm_set1_epi8(c);
+
+  for (; i + 16 <= len; i += 16) {
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(str + i)), needle));
+
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+  #endif /*__SSE2__*/
+
+  const char *p = (const char *)memchr(str + i, c, len - i);
+  return p ? p - str : len;
+}
+
+char *RSPutf8(unsigned int cp, char *out) { // write a code point as utf-8
+  if (cp < 0x80)
+    *out++ = cp;
+  else if (cp < 0x800) {
+    *out++ = 0xC0 | (cp >> 6);
+    *out++ = 0x80 | (cp & 0x3F);
+  }
+  else if (cp < 0x10000) {
+    *out++ = 0xE0 | (cp >> 12);
+    *out++ = 0x80 | ((cp >> 6) & 0x3F);
+    *out++ = 0x80 | (cp & 0x3F);
+  }
+  else {
+    *out++ = 0xF0 | (cp >> 18);
+    *out++ = 0x80 | ((cp >> 12) & 0x3F);
+    *out++ = 0x80 | ((cp >> 6) & 0x3F);
+    *out++ = 0x80 | (cp & 0x3F);
+  }
+
+  return out;
+}
+
+int RSPhex(std::string_view str, size_t i, size_t n) { // read n hex digits at i, -1 if they aren't hex
+  if (i + n > str.size())
+    return -1;
+
+  int v = 0;
+
+  for (size_t j = i; j < i + n; j++) {
+    char h = str[j];
+
+    if (!isxdigit((unsigned char)h))
+      return -1;
+
+    v = (v << 4) | ((h <= '9') ? h - '0' : (h | 0x20) - 'a' + 10);
+  }
+
+  return v;
+}
+
+bool RSP::hasEscapes(std::string_view str, RSP::format c) {
+  return RSPfind(str.data(), str.size(), (c == XML || c == HTML || c == SVG) ? '&' : '\\') < str.size();
+}
+
+// decodes str into o and returns the end of the output. The output is never longer
+// than the input and never runs ahead of it, so o may point at str itself
+char *RSPunescapeTo(std::string_view str, RSP::format c, char *o) {
+  if (c == RSP::XML || c == RSP::HTML || c == RSP::SVG) {
+    for (size_t i = 0; i < str.size(); i++) {
+      if (str[i] != '&') {
+        *o++ = str[i];
+        continue;
+      }
+
+      size_t end = str.substr(0, i + 11).find(';', i); // entities are short, don't scan the whole text
+
+      if (end == std::string_view::npos) {
+        *o++ = str[i];
+        continue;
+      }
+
+      std::string_view name = str.substr(i + 1, end - i - 1);
+      long cp = -1;
+
+      if (name == "amp") cp = '&';
+      else if (name == "lt") cp = '<';
+      else if (name == "gt") cp = '>';
+      else if (name == "quot") cp = '\"';
+      else if (name == "apos") cp = '\'';
+      else if (name == "nbsp") cp = 0xA0;
+      else if (name.size() > 1 && name[0] == '#') {
+        char *numEnd;
+        std::string num(name.substr((name[1] == 'x' || name[1] == 'X') ? 2 : 1));
+
+        cp = strtol(num.c_str(), &numEnd, (name[1] == 'x' || name[1] == 'X') ? 16 : 10);
+
+        if (num.empty() || *numEnd || cp < 0 || cp > 0x10FFFF)
+          cp = -1;
+      }
+
+      if (cp < 0) { // not an entity we know, keep it as is
+        *o++ = str[i];
+        continue;
+      }
+
+      o = RSPutf8(cp, o);
+      i = end;
+    }
+  }
+
+  else {
+    for (size_t i = 0; i < str.size(); i++) {
+      if (str[i] != '\\' || i + 1 >= str.size()) {
+        *o++ = str[i];
+        continue;
+      }
+
+      switch (str[++i]) {
+        case '"': *o++ = '"'; break;
+        case '\\': *o++ = '\\'; break;
+        case '/': *o++ = '/'; break;
+        case 'b': *o++ = '\b'; break;
+        case 'f': *o++ = '\f'; break;
+        case 'n': *o++ = '\n'; break;
+        case 'r': *o++ = '\r'; break;
+        case 't': *o++ = '\t'; break;
+        case 'u': {
+          int cp = RSPhex(str, i + 1, 4);
+
+          if (cp < 0) { // bad \u, keep it as is
+            *o++ = '\\';
+            *o++ = 'u';
+            break;
+          }
+
+          i += 4;
+
+          if (cp >= 0xD800 && cp <= 0xDBFF && i + 2 < str.size() && str[i + 1] == '\\' && str[i + 2] == 'u') { // surrogate pair
+            int low = RSPhex(str, i + 3, 4);
+
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+              cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+              i += 6;
+            }
+          }
+
+          o = RSPutf8(cp, o);
+          break;
+        }
+        default: // unknown escape, keep it as is
+          *o++ = '\\';
+          *o++ = str[i];
+          break;
+      }
+    }
+  }
+
+  return o;
+}
+
+std::string_view RSP::unescape(std::string_view str, RSP::format c, RSP::arena &a, bool quoted) {
+  if (quoted && str.size() >= 2 && (str[0] == '\"' || str[0] == '\'') && str.back() == str[0]) // strip the quotes
+    str = str.substr(1, str.size() - 2);
+
+  if (!hasEscapes(str, c)) // fast path, nothing to decode
+    return str;
+
+  char *out = a.alloc(str.size());
+  return std::string_view(out, RSPunescapeTo(str, c, out) - out);
+}
+
+std::string RSP::escape(std::string_view str, RSP::format c) {
+  bool xml = (c == XML || c == HTML || c == SVG);
+
+  size_t i;
+  for (i = 0; i < str.size(); i++) { // find the first character that has to be escaped
+    unsigned char ch = str[i];
+
+    if (xml ? (ch == '&' || ch == '<' || ch == '>' || ch == '"') : (ch == '"' || ch == '\\' || ch < 0x20))
+      break;
+  }
+
+  std::string output(str.substr(0, i));
+
+  if (i == str.size()) // fast path, nothing to escape
+    return output;
+
+  for (; i < str.size(); i++) {
+    unsigned char ch = str[i];
+
+    if (xml) {
+      switch (ch) {
+        case '&': output += "&amp;"; break;
+        case '<': output += "&lt;"; break;
+        case '>': output += "&gt;"; break;
+        case '"': output += "&quot;"; break;
+        default: output += ch; break;
+      }
+    }
+
+    else {
+      switch (ch) {
+        case '"': output += "\\\""; break;
+        case '\\': output += "\\\\"; break;
+        case '\b': output += "\\b"; break;
+        case '\f': output += "\\f"; break;
+        case '\n': output += "\\n"; break;
+        case '\r': output += "\\r"; break;
+        case '\t': output += "\\t"; break;
+        default:
+          if (ch < 0x20) {
+            char u[7];
+            snprintf(u, sizeof(u), "\\u%04x", ch);
+            output += u;
+          }
+          else
+            output += ch;
+          break;
+      }
+    }
+  }
+
+  return output;
+}
+
+void RSPdecode(std::string &str, RSP::format c, bool quoted = true) { // decode a token's data in place
+  if (quoted && str.size() >= 2 && (str[0] == '\"' || str[0] == '\'') && str.back() == str[0]) { // strip the quotes
+    str.pop_back();
+    str.erase(0, 1);
+  }
+
+  if (RSP::hasEscapes(str, c))
+    str.resize(RSPunescapeTo(str, c, &str[0]) - str.data());
+}
+
+const std::vector<std::string> RSPhtmlVoidTags = {"area", "base", "br", "col", "command", "embed", "hr", "img", "input", "keygen", "link", "meta", "param", "source", "track", "wbr"}; // HTML's void tags
+
+size_t RSPtagEnd(const std::string &data, size_t i = 0) { // find the > that ends a tag, skipping quoted attribute values
+  char quote = 0;
+
+  for (; i < data.size(); i++) {
+    if (quote) {
+      if (data[i] == quote)
+        quote = 0;
+    }
+    else if (data[i] == '"' || data[i] == '\'')
+      quote = data[i];
+    else if (data[i] == '>')
+      return i;
+  }
+
+  return data.size();
+}
+
+struct RSPtokenList : std::vector<RSP::token> {
+  std::string *error; // where to write the first problem (NULL if we're not checking)
+  bool json;
+  std::vector<std::string> open; // tags (XML) or { and [ (JSON) that are still open
 
-  std::vector<RSP::token> tokens; // output tokens
+  RSPtokenList(std::string *error, bool json) : error(error), json(json) {}
+
+  void fail(const std::string &msg) {
+    if (error->empty())
+      *error = msg;
+  }
+
+  void push_back(const RSP::token &t) { // add a token, checking it makes sense with the tokens before it
+    std::vector<RSP::token>::push_back(t);
+
+    if (error == NULL || error->size())
+      return;
+
+    switch (t.t) {
+      case RSP::open:
+        open.push_back(json ? "{" : t.data);
+        break;
+      case RSP::openList:
+        open.push_back("[");
+        break;
+      case RSP::close:
+      case RSP::closeList: {
+        std::string name = json ? (t.t == RSP::close ? "{" : "[") : t.data.substr(0, t.data.find_last_not_of(' ') + 1);
+
+        if (open.empty())
+          fail("Unexpected close " + (json ? std::string(t.t == RSP::close ? "}" : "]") : "</" + name + ">"));
+        else if (name.size() && name != open.back())
+          fail(json ? "Mismatched " + std::string(t.t == RSP::close ? "}" : "]") : "Mismatched </" + name + ">, expected </" + open.back() + ">");
+        else
+          open.pop_back();
+        break;
+      }
+      case RSP::value:
+        if (json && t.data.size()) {
+          char first = t.data[0], last = t.data.back();
+
+          size_t slashes = 0; // an odd number of \\ before the last " escapes it
+          for (size_t i = t.data.size() - 1; i > 0 && t.data[i - 1] == '\\'; i--)
+            slashes++;
+
+          if (first == '"' && (t.data.size() < 2 || last != '"' || slashes % 2))
+            fail("Unterminated string " + t.data);
+          else if ((first == '{' && last != '}') || (first == '[' && last != ']'))
+            fail("Unclosed " + std::string(1, first) + " in list");
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  std::vector<RSP::token> finish() {
+    if (error && open.size())
+      fail(json ? "Unclosed " + open.back() : "Unclosed <" + open.back() + ">");
+
+    return std::move(*this);
+  }
+}; // token list that checks the tokens are well-formed as they're added
+
+std::vector<RSP::token> RSP::tokenizeXML(std::string data, format c, std::string *error){
+  // if we're using HTML, use HTML's void tags (without writing to voidTags, so threads can tokenize at once)
+  const std::vector<std::string> &voidTags = (c == HTML) ? RSPhtmlVoidTags : RSP::voidTags;
+
+  RSPtokenList tokens(error, false); // output tokens
 
   for (int i = 0; i < data.size(); i++){ // loop through the data
     switch (data[i]){
     case '<': { // if the data is a <, let's check it
-      if (data[i + 1] != '!'){                                                // if it has a ! after the <, it's a comment tag, so only check it if it's not a comment
+      if (data[i + 1] != '!' && data[i + 1] != '?'){                         // if it has a ! or ? after the <, it's a comment, doctype or xml declaration, so only check it if it's not one of those
         token t = {data[i + 1] != '/' ? open : close}; // if there is a / after the <, it's a close tag, else it's an open tag
 
         // get the tag's name
@@ -143,12 +655,14 @@ std::vector<RSP::token> RSP::tokenizeXML(std::string data, format c){
             t.data.begin() + i + ((data[i + 1] != '/') ? 1 : 2), // if it has a / after, replace an extra character
             "");                                                 // delete all the text up to the name
 
-        int newI = t.data.find_first_of(">") + ((data[i + 1] != '/') ? 1 : 2) + i;
+        int newI = RSPtagEnd(t.data) + ((data[i + 1] != '/') ? 1 : 2) + i;
+
+        t.data.replace(t.data.begin() + RSPtagEnd(t.data), t.data.end(), ""); // delete everything after the tag closes (gets the name if there are no args)
 
-        t.data.replace(t.data.begin() + t.data.find_first_of(">"), t.data.end(), ""); // delete everything after the tag closes (gets the name if there are no args)
+        std::string name = t.data.substr(0, t.data.find_first_of(' ')); // tag name
 
-        int dist = std::distance(voidTags.begin(), std::find(voidTags.begin(), voidTags.end(), t.data));
-        bool isVoid = (dist < t.data.size());
+        int dist = std::distance(voidTags.begin(), std::find(voidTags.begin(), voidTags.end(), name));
+        bool isVoid = (dist < voidTags.size());
 
         // check if there is a space and thereby, if there will be args
         if (t.data.find_first_of(' ') < t.data.size())
@@ -166,7 +680,7 @@ std::vector<RSP::token> RSP::tokenizeXML(std::string data, format c){
               argData.begin() + i + ((data[i + 1] != '/') ? 1 : 2) + nameS + 1, // if it has a / after, replace an extra character, replace up to args + space
               "");                                                              // delete all the text up to the args
 
-          argData.replace(argData.begin() + argData.find_first_of(">"), argData.end(), ""); // delete everything after the tag closes to get just the args
+          argData.replace(argData.begin() + RSPtagEnd(argData), argData.end(), ""); // delete everything after the tag closes to get just the args
 
           for (int j = 0; j < argData.size(); j++)
           {
@@ -199,10 +713,11 @@ std::vector<RSP::token> RSP::tokenizeXML(std::string data, format c){
 
               t.data.replace(t.data.begin(), t.data.begin() + t.data.find_first_not_of(' '), "");
 
-              tokens.push_back(t); // push the value
-
               int argSize = t.data.size();
 
+              RSPdecode(t.data, c); // strip the quotes, decode entities
+              tokens.push_back(t); // push the value
+
               argData.replace(argData.begin(), argData.begin() + j + 1, "");
               argData.replace(argData.begin(), argData.begin() + argSize + 1, "");
 
@@ -218,8 +733,7 @@ std::vector<RSP::token> RSP::tokenizeXML(std::string data, format c){
 
         if (isVoid)
         {
-          t.t = close;
-          tokens.push_back(t);
+          tokens.push_back({close, name});
         }
 
         i = newI;
@@ -228,7 +742,7 @@ std::vector<RSP::token> RSP::tokenizeXML(std::string data, format c){
           tokens.push_back({close});
       }
       else
-        i += data.find_first_of(">", i) + 1; // skip after tag
+        i = std::min(data.find_first_of(">", i), data.size()); // skip after tag
       break;
     }
 
@@ -243,16 +757,17 @@ std::vector<RSP::token> RSP::tokenizeXML(std::string data, format c){
         i += t.data.find_first_of('<') + t.data.size(); // set index to where next open tag is
       }
 
+      RSPdecode(t.data, c, false); // decode entities
       tokens.push_back(t); // send content tag
       break;
     }
   }
 
-  return tokens;
+  return tokens.finish();
 }
 
-std::vector<RSP::token> RSP::tokenizeJSON(std::string data){
-  std::vector<RSP::token> tokens;
+std::vector<RSP::token> RSP::tokenizeJSON(std::string data, std::string *error){
+  RSPtokenList tokens(error, true);
   int list = 0;
 
   for (int i = 0; i < data.size(); i++)
@@ -270,10 +785,16 @@ std::vector<RSP::token> RSP::tokenizeJSON(std::string data){
 
       t.data.replace(t.data.begin(), t.data.begin() + t.data.find_first_of('\"') + 1, "");
 
-      t.data.replace(t.data.begin() + t.data.find_first_of('\"'), t.data.end(), "");
+      size_t quote = t.data.find_first_of('\"');
+
+      while (quote + 1 < t.data.size() && t.data[quote + 1] == '\\') // skip escaped quotes (reversed, so the \\ comes after)
+        quote = t.data.find_first_of('\"', quote + 1);
+
+      t.data.replace(t.data.begin() + quote, t.data.end(), "");
 
       std::reverse(t.data.begin(), t.data.end());
 
+      RSPdecode(t.data, JSON);
       tokens.push_back(t);
 
       t = {value, data};
@@ -378,7 +899,7 @@ std::vector<RSP::token> RSP::tokenizeJSON(std::string data){
     }
   }
 
-  return tokens;
+  return tokens.finish();
 }
 
 std::vector<RSP::token> RSP::tokenizeCSV(std::string data, RSP::format c) {
@@ -513,6 +1034,7 @@ RSP::data RSP::parseJSON(std::vector<RSP::token> tokens){
   std::vector<RSP::data> prev;
 
   std::string curArg;
+  bool isString;
 
   int list = 0;
 
@@ -543,14 +1065,17 @@ RSP::data RSP::parseJSON(std::vector<RSP::token> tokens){
       break;
 
     case value:
-      std::reverse(t.data.begin(), t.data.end());
-      t.data.replace(t.data.begin(), t.data.begin() + t.data.find_first_not_of(' '), "");
-      std::reverse(t.data.begin(), t.data.end());
+      t.data.erase(t.data.find_last_not_of(" \t\r") + 1);
+
+      isString = (t.data[0] == '\"'); // strings are decoded here, while the quotes still tell them apart from objects and lists
+
+      if (isString)
+        RSPdecode(t.data, JSON);
 
       if (list == false)
-        index.push(curArg, t.data);
+        index.push({.key = curArg, .value = t.data, .quoted = isString});
       else {
-        if (t.data[0] == '{' || t.data[0] == '[') {
+        if (!isString && (t.data[0] == '{' || t.data[0] == '[')) {
           if (t.data[0] == '{')
             index.list.push_back(loadS(t.data, JSON));
           else if (t.data[0] == '['){
@@ -558,7 +1083,7 @@ RSP::data RSP::parseJSON(std::vector<RSP::token> tokens){
           }
         }
         else
-          index.list.push_back({"", t.data});
+          index.list.push_back({.key = "", .value = t.data, .quoted = isString});
       }
       break;
 
@@ -584,15 +1109,15 @@ RSP::data RSP::parseJSON(std::vector<RSP::token> tokens){
     }
   }
 
-  if (index.next.size())
-    return index[""];
-  else{
-    #ifndef RSP_QUIET_ERRORS
-    printf("Failed to parse JSON tokens\n");
-    #endif /*RSP_QUIET_ERRORS*/
+  for (auto &d : index.next) // not index[""], it writes to the shared error obj, and loadMany parses on many threads
+    if (d.key == "")
+      return d;
 
-    return {"RSP-ERROR", "Failed to parse tokens"};
-  }
+  #ifndef RSP_QUIET_ERRORS
+  printf("Failed to parse JSON tokens\n");
+  #endif /*RSP_QUIET_ERRORS*/
+
+  return {"RSP-ERROR", "Failed to parse tokens"};
 }
 
 RSP::data RSP::parseXML(std::vector<RSP::token> tokens, RSP::format c) {
@@ -641,132 +1166,2253 @@ RSP::data RSP::parseXML(std::vector<RSP::token> tokens, RSP::format c) {
   return index;
 }
 
-RSP::data RSP::loadF(std::string file, RSP::format c)
-{
-  FILE *f = fopen(file.c_str(), "r");
+RSP::data RSP::parseXMLParallel(std::string data, RSP::format c, unsigned int threads) {
+  const std::vector<std::string> &voidTags = (c == HTML) ? RSPhtmlVoidTags : RSP::voidTags;
 
-  fseek(f, 0L, SEEK_END);
+  std::vector<std::pair<size_t, size_t>> children; // where each of the root's children starts and ends
+  size_t rootStart = 0, rootEnd = 0, rootClose = 0, childStart = 0;
+  int depth = 0;
 
-  const int size = ftell(f);
+  // find the root's children, skipping comments, CDATA and quoted attribute values
+  for (size_t i = data.find('<'); i < data.size(); i = data.find('<', i)) {
+    if (!data.compare(i, 4, "<!--")) {
+      i = std::min(data.find("-->", i + 4), data.size() - 3) + 3;
+      continue;
+    }
 
-  fseek(f, 0L, SEEK_SET);
+    if (!data.compare(i, 9, "<![CDATA[")) {
+      i = std::min(data.find("]]>", i + 9), data.size() - 3) + 3;
+      continue;
+    }
 
-  char fData[size];
+    if (data[i + 1] == '!' || data[i + 1] == '?') { // <!DOCTYPE ...>, <?xml ...?>
+      i = std::min(data.find('>', i), data.size() - 1) + 1;
+      continue;
+    }
 
-  fread(fData, 1, size, f);
+    size_t end = RSPtagEnd(data, i + 1);
 
-  fclose(f);
+    if (end >= data.size()) // the tag never ends
+      break;
 
-  return loadS(fData);
-}
+    bool close = (data[i + 1] == '/');
+    size_t nameStart = i + (close ? 2 : 1);
+    std::string name = data.substr(nameStart, data.find_first_of(" \t\r\n/>", nameStart) - nameStart);
+    bool isVoid = (data[end - 1] == '/' || std::find(voidTags.begin(), voidTags.end(), name) != voidTags.end());
 
-RSP::data RSP::loadS(std::string data, RSP::format c){
-  if (c == GUESS){
-    if ((data.find_first_of('<') > data.find_first_of(',') && data.find_first_of('{') > data.find_first_of(',')) ||
-        (data.find_first_of('<') > data.find_first_of(';') && data.find_first_of('{') > data.find_first_of(';')))
-      c = CSV_GUESS;
+    if (close) {
+      depth--;
 
-    else if (data.find_first_of('<') > data.find_first_of('{'))
-      c = JSON;
+      if (depth == 1)
+        children.push_back({childStart, end + 1});
+      else if (depth == 0)
+        rootClose = i;
+    }
+    else if (isVoid) {
+      if (depth == 1)
+        children.push_back({i, end + 1});
+    }
+    else {
+      if (depth == 0) {
+        rootStart = i;
+        rootEnd = end + 1;
+      }
+      else if (depth == 1)
+        childStart = i;
 
-    else if (data.find_first_of("html") < data.size())
-      c = HTML;
-    else if (data.find_first_not_of("svg") < data.size())
-      c = SVG;
-    else
-      c = XML;
-  }
+      depth++;
+    }
 
-  while (data.find('\n') < data.size() && (c != CSV_COMMA && c != CSV_SEMI && c != CSV_GUESS))
-    data.replace(data.begin() + data.find('\n'), data.begin() + data.find('\n') + 1, "");
+    i = end + 1;
+  }
 
-  if (c == SVG || c == XML || c == HTML)
+  if (depth != 0 || rootEnd == 0) { // not something we can split up, parse it the normal way
+    data.erase(std::remove(data.begin(), data.end(), '\n'), data.end());
     return parseXML(tokenizeXML(data, c), c);
-  else if (c == JSON)
-    return parseJSON(tokenizeJSON(data));
-  else
-    return parseCSV(tokenizeCSV(data, c));
-}
+  }
 
-void RSP::dumpF(std::string file, RSP::data d, RSP::format c) {
-  std::string dStr = dumpF(d, c);
+  // parse the root without its children to get its name, args and text (the comments keep the text runs apart, like the children did)
+  std::string rootTag = data.substr(rootStart, rootEnd - rootStart);
+  size_t gap = rootEnd;
 
-  FILE *f = fopen(file.c_str(), "w+");
+  for (auto &child : children) {
+    rootTag += data.substr(gap, child.first - gap) + "<!-- -->";
+    gap = child.second;
+  }
 
-  fwrite(dStr.c_str(), 1, dStr.size(), f);
+  rootTag += data.substr(gap, data.find('>', rootClose) + 1 - gap);
+  rootTag.erase(std::remove(rootTag.begin(), rootTag.end(), '\n'), rootTag.end());
 
-  fclose(f);
+  RSP::data root = parseXML(tokenizeXML(rootTag, c), c);
+  root.next.resize(children.size());
+
+  if (!threads)
+    threads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+  if (threads > children.size())
+    threads = children.size();
+
+  // each thread parses a block of children in place
+  std::vector<std::thread> workers;
+
+  for (size_t t = 0; t < threads; t++) {
+    workers.push_back(std::thread([&, t]() {
+      for (size_t i = children.size() * t / threads; i < children.size() * (t + 1) / threads; i++) {
+        std::string child = data.substr(children[i].first, children[i].second - children[i].first);
+        child.erase(std::remove(child.begin(), child.end(), '\n'), child.end());
+
+        root.next[i] = parseXML(tokenizeXML(child, c), c);
+      }
+    }));
+  }
+
+  for (auto &w : workers)
+    w.join();
+
+  return root;
 }
 
-void RSPjsonStr(RSP::data d, std::string &str) {
-  int i = 0;
+struct RSPselector {
+  char combinator = 0;              // how this relates to the selector before it, ' ' (descendant), '>' (child) or 0 (first)
+  std::string tag, id;              // tag name ("" or "*" for any), id
+  std::vector<std::string> classes; // classes the node must have
+  std::vector<std::pair<std::string, std::string>> attrs; // [attr=value]
+  std::vector<bool> anyValue;       // true for [attr] (any value)
+}; // one compound selector, ex. div#main.big[lang=en]
+
+std::vector<std::vector<RSPselector>> RSPparseSelector(const std::string &selector) { // split a selector into groups of compound selectors
+  std::vector<std::vector<RSPselector>> groups(1);
+  RSPselector cur;
+  bool empty = true;
+  char combinator = 0; // combinator waiting for the next compound selector
+
+  auto name = [&](size_t &i) { // read a name at i
+    size_t start = i;
+
+    for (; i < selector.size() && !strchr(" \t\n>,#.[]=\"'", selector[i]); i++);
+
+    return selector.substr(start, i - start);
+  };
+
+  for (size_t i = 0; i < selector.size();) {
+    char ch = selector[i];
+
+    if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '>' || ch == ',') { // end of a compound selector
+      if (!empty) {
+        groups.back().push_back(cur);
+        cur = RSPselector();
+        empty = true;
+        combinator = ' ';
+      }
 
-  for (auto &n : d.next)
-  {
-    i++;
+      if (ch == '>')
+        combinator = '>';
+      else if (ch == ',') {
+        groups.emplace_back();
+        combinator = 0;
+      }
 
-    if (n.key[0] != '\"')
-    {
-      n.key.insert(n.key.begin(), '\"');
+      i++;
+      continue;
+    }
 
-      n.key += "\"";
+    if (empty) { // start of a compound selector
+      cur.combinator = groups.back().empty() ? 0 : combinator;
+      empty = false;
     }
 
-    if (n.next.size())
-    {
-      str += "\n\n" + n.key + " : " + " {";
-      RSPjsonStr(n, str);
-      str += "\n}";
+    if (ch == '#') {
+      i++;
+      cur.id = name(i);
+    }
+    else if (ch == '.') {
+      i++;
+      cur.classes.push_back(name(i));
     }
+    else if (ch == '[') {
+      i++;
+      std::string attr = name(i), value;
+      bool any = true;
+
+      if (i < selector.size() && selector[i] == '=') {
+        any = false;
+        i++;
+
+        if (i < selector.size() && (selector[i] == '"' || selector[i] == '\'')) { // quoted value
+          size_t end = std::min(selector.find(selector[i], i + 1), selector.size());
+          value = selector.substr(i + 1, end - i - 1);
+          i = end;
+        }
+        else
+          value = name(i);
+      }
 
-    else
-      str += "\n" + n.key + ":" + n.value;
+      i = std::min(selector.find(']', i), selector.size()) + 1;
 
-    if (i < d.next.size())
-      str += ",";
+      cur.attrs.push_back({attr, value});
+      cur.anyValue.push_back(any);
+    }
+    else if (ch == '*') {
+      i++;
+      cur.tag = "*";
+    }
+    else {
+      std::string tag = name(i);
+
+      if (tag.empty()) // not something we know, skip it
+        i++;
+      else
+        cur.tag = tag;
+    }
   }
+
+  if (!empty)
+    groups.back().push_back(cur);
+
+  groups.erase(std::remove_if(groups.begin(), groups.end(), [](std::vector<RSPselector> &g) { return g.empty(); }), groups.end());
+  return groups;
 }
 
-void RSPXMLStr(RSP::data d, std::string &str)
-{
-  for (auto &n : d.next)
-  {
-    str += "<" + n.key;
+bool RSPhasClass(RSP::data &node, const std::string &name) { // check if a node's class list has a class
+  auto c = node.args.find("class");
 
-    for (auto &a : n.args)
-      str += " " + a.first + "=" + a.second;
+  if (c == node.args.end())
+    return false;
 
-    str += ">\n";
+  const std::string &list = c->second;
 
-    str += n.value + "\n";
+  for (size_t i = list.find(name); i < list.size(); i = list.find(name, i + 1))
+    if ((!i || isspace((unsigned char)list[i - 1])) && (i + name.size() == list.size() || isspace((unsigned char)list[i + name.size()])))
+      return true;
 
-    if (n.next.size())
-    {
-      str += "\n";
-      RSPXMLStr(n, str);
-    }
+  return false;
+}
 
-    str += "</" + n.key + ">\n";
+bool RSPmatch(const RSPselector &sel, RSP::data &node) { // check if a node matches a compound selector
+  if (sel.tag.size() && sel.tag != "*" && sel.tag != node.key)
+    return false;
+
+  if (sel.id.size()) {
+    auto id = node.args.find("id");
+
+    if (id == node.args.end() || id->second != sel.id)
+      return false;
   }
+
+  for (auto &c : sel.classes)
+    if (!RSPhasClass(node, c))
+      return false;
+
+  for (size_t i = 0; i < sel.attrs.size(); i++) {
+    auto a = node.args.find(sel.attrs[i].first);
+
+    if (a == node.args.end() || (!sel.anyValue[i] && a->second != sel.attrs[i].second))
+      return false;
+  }
+
+  return true;
 }
 
-std::string RSP::dumpF(RSP::data d, RSP::format c)
-{
-  std::string output;
+// check the selectors left of pos against the node's ancestors (path is root ... parent)
+bool RSPmatchPath(const std::vector<RSPselector> &sels, size_t pos, const std::vector<RSP::data *> &path, size_t depth) {
+  if (!pos) // every selector matched
+    return true;
 
-  if (c == JSON)
-  {
-    output += "{";
-    RSPjsonStr(d, output);
-    output += "\n\n}";
+  if (sels[pos].combinator == '>')
+    return depth && RSPmatch(sels[pos - 1], *path[depth - 1]) && RSPmatchPath(sels, pos - 1, path, depth - 1);
+
+  for (size_t d = depth; d > 0; d--) // descendant, try every ancestor
+    if (RSPmatch(sels[pos - 1], *path[d - 1]) && RSPmatchPath(sels, pos - 1, path, d - 1))
+      return true;
+
+  return false;
+}
+
+void RSPindexNode(RSP::nodeIndex &idx, RSP::data &node, RSP::data *parent) {
+  idx.order[&node] = idx.nodes.size();
+  idx.nodes.push_back(&node);
+  idx.parents[&node] = parent;
+  idx.tags[node.key].push_back(&node);
+
+  auto id = node.args.find("id");
+  if (id != node.args.end())
+    idx.ids[id->second].push_back(&node);
+
+  auto c = node.args.find("class");
+  if (c != node.args.end()) {
+    const std::string &list = c->second;
+
+    for (size_t i = list.find_first_not_of(" \t\n"); i < list.size();) {
+      size_t end = std::min(list.find_first_of(" \t\n", i), list.size());
+      auto &nodes = idx.classes[list.substr(i, end - i)];
+
+      if (nodes.empty() || nodes.back() != &node) // class="a a"
+        nodes.push_back(&node);
+
+      i = list.find_first_not_of(" \t\n", end);
+    }
   }
 
-  else if (c == HTML || c == XML || c == SVG) {
-    output += "<!DOCTYPE " + (std::string)((c == HTML) ? "html" : (c == XML) ? "xml"
-                                                                             : "svg") +
-              ">\n";
+  for (auto &n : node.next)
+    RSPindexNode(idx, n, &node);
+}
 
-    RSPXMLStr(d, output);
+RSP::nodeIndex RSP::buildIndex(RSP::data &root) {
+  RSP::nodeIndex idx;
+  RSPindexNode(idx, root, NULL);
+
+  return idx;
+}
+
+void RSPselectWalk(const std::vector<std::vector<RSPselector>> &groups, RSP::data &node, std::vector<RSP::data *> &path, std::vector<RSP::data *> &output) {
+  for (auto &g : groups) {
+    if (RSPmatch(g.back(), node) && RSPmatchPath(g, g.size() - 1, path, path.size())) {
+      output.push_back(&node);
+      break;
+    }
+  }
+
+  path.push_back(&node);
+
+  for (auto &n : node.next)
+    RSPselectWalk(groups, n, path, output);
+
+  path.pop_back();
+}
+
+std::vector<RSP::data *> RSP::select(RSP::data &root, std::string selector) {
+  std::vector<RSP::data *> output, path;
+  RSPselectWalk(RSPparseSelector(selector), root, path, output);
+
+  return output;
+}
+
+std::vector<RSP::data *> RSP::select(RSP::nodeIndex &idx, std::string selector) {
+  std::vector<RSP::data *> output, path;
+  static const std::vector<RSP::data *> none;
+
+  auto groups = RSPparseSelector(selector);
+
+  for (auto &g : groups) {
+    const RSPselector &last = g.back();
+    const std::vector<RSP::data *> *candidates = &idx.nodes;
+
+    // start from the smallest set the index has for the rightmost selector
+    if (last.id.size()) {
+      auto id = idx.ids.find(last.id);
+      candidates = (id != idx.ids.end()) ? &id->second : &none;
+    }
+    else {
+      if (last.tag.size() && last.tag != "*") {
+        auto t = idx.tags.find(last.tag);
+        candidates = (t != idx.tags.end()) ? &t->second : &none;
+      }
+
+      for (auto &c : last.classes) {
+        auto cl = idx.classes.find(c);
+        const std::vector<RSP::data *> *list = (cl != idx.classes.end()) ? &cl->second : &none;
+
+        if (list->size() < candidates->size())
+          candidates = list;
+      }
+    }
+
+    for (auto n : *candidates) {
+      if (!RSPmatch(last, *n))
+        continue;
+
+      path.clear();
+      if (g.size() > 1) // get the ancestors, only if we have to check them
+        for (RSP::data *p = idx.parents.at(n); p; p = idx.parents.at(p))
+          path.insert(path.begin(), p);
+
+      if (RSPmatchPath(g, g.size() - 1, path, path.size()))
+        output.push_back(n);
+    }
+  }
+
+  if (groups.size() > 1) { // more than one group can match a node, keep document order and remove repeats
+    std::sort(output.begin(), output.end(), [&](RSP::data *a, RSP::data *b) { return idx.order[a] < idx.order[b]; });
+    output.erase(std::unique(output.begin(), output.end()), output.end());
+  }
+
+  return output;
+}
+
+void RSPreadahead(const std::string &file) { // ask the OS to start reading a file we'll need soon
+  #ifdef __linux__
+  int fd = open(file.c_str(), O_RDONLY);
+
+  if (fd >= 0) {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+  }
+  #endif /*__linux__*/
+}
+
+RSP::stream::stream(std::string file, size_t blockSize) : blockSize(blockSize) {
+  f = fopen(file.c_str(), "rb");
+
+  if (f == NULL) {
+    failed = true;
+    error = "Failed to open file";
+    return;
+  }
+
+  #ifdef __linux__
+  posix_fadvise(fileno(f), 0, 0, POSIX_FADV_SEQUENTIAL);
+  #endif /*__linux__*/
+
+  fseek(f, 0L, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0L, SEEK_SET);
+
+  // check the magic bytes
+  unsigned char magic[4] = {0};
+  size_t magicSize = fread(magic, 1, 4, f);
+  fseek(f, 0L, SEEK_SET);
+
+  bool gzip = (magicSize >= 2 && magic[0] == 0x1F && magic[1] == 0x8B);
+  bool zstd = (magicSize == 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD);
+
+  #ifndef RSP_ZLIB
+  if (gzip) {
+    failed = true;
+    error = "File is gzip compressed (define RSP_ZLIB to load it)";
+    return;
+  }
+  #endif /*RSP_ZLIB*/
+
+  #ifndef RSP_ZSTD
+  if (zstd) {
+    failed = true;
+    error = "File is zstd compressed (define RSP_ZSTD to load it)";
+    return;
+  }
+  #endif /*RSP_ZSTD*/
+
+  worker = std::thread([this, gzip, zstd]() {
+    // hand a block to read(), waiting while there's already enough decompressed ahead
+    auto push = [this](std::string &block) {
+      std::unique_lock<std::mutex> l(lock);
+      wait.wait(l, [this]() { return blocks.size() < 4 || stop; });
+
+      if (stop)
+        return false;
+
+      blocks.push_back(std::move(block));
+      wait.notify_all();
+      return true;
+    };
+
+    #if defined(RSP_ZLIB) || defined(RSP_ZSTD)
+    auto fail = [this](const char *msg) {
+      std::lock_guard<std::mutex> l(lock);
+      failed = true;
+      error = msg;
+    };
+    #endif
+
+    std::string in(this->blockSize, '\0'), out;
+    size_t inSize;
+
+    if (!gzip && !zstd) {
+      while ((inSize = fread(&in[0], 1, in.size(), f))) {
+        out = in.substr(0, inSize);
+
+        if (!push(out))
+          break;
+      }
+    }
+
+    #ifdef RSP_ZLIB
+    else if (gzip) {
+      z_stream z = {};
+      inflateInit2(&z, 15 + 32); // 15 bit window, + 32 to read the gzip header
+
+      bool running = true, ended = false; // ended : the last gzip member was read to its end
+
+      while (running && (inSize = fread(&in[0], 1, in.size(), f))) {
+        z.next_in = (Bytef *)&in[0];
+        z.avail_in = inSize;
+
+        do { // until the input is used up and there's no output left behind
+          out.resize(this->blockSize);
+          z.next_out = (Bytef *)&out[0];
+          z.avail_out = out.size();
+
+          int ret = inflate(&z, Z_NO_FLUSH);
+
+          if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            fail("Failed to decompress gzip data");
+            running = false;
+            break;
+          }
+
+          out.resize(out.size() - z.avail_out);
+
+          if (out.size() && !push(out))
+            running = false;
+
+          if (ret == Z_OK)
+            ended = false;
+
+          if (ret == Z_STREAM_END) { // concatenated gzip members
+            ended = true;
+            inflateReset(&z);
+          }
+        } while (running && (z.avail_in || !z.avail_out));
+      }
+
+      if (running && !ended)
+        fail("Truncated gzip data");
+
+      inflateEnd(&z);
+    }
+    #endif /*RSP_ZLIB*/
+
+    #ifdef RSP_ZSTD
+    else if (zstd) {
+      ZSTD_DStream *z = ZSTD_createDStream();
+      ZSTD_initDStream(z);
+
+      bool running = true, full;
+      size_t ret = 0; // 0 once a frame is read to its end
+
+      while (running && (inSize = fread(&in[0], 1, in.size(), f))) {
+        ZSTD_inBuffer zIn = {in.data(), inSize, 0};
+
+        do { // until the input is used up and there's no output left behind
+          out.resize(this->blockSize);
+          ZSTD_outBuffer zOut = {&out[0], out.size(), 0};
+
+          ret = ZSTD_decompressStream(z, &zOut, &zIn);
+
+          if (ZSTD_isError(ret)) {
+            fail("Failed to decompress zstd data");
+            running = false;
+            break;
+          }
+
+          full = (zOut.pos == zOut.size);
+          out.resize(zOut.pos);
+
+          if (out.size() && !push(out))
+            running = false;
+        } while (running && (zIn.pos < zIn.size || full));
+      }
+
+      if (running && ret != 0)
+        fail("Truncated zstd data");
+
+      ZSTD_freeDStream(z);
+    }
+    #endif /*RSP_ZSTD*/
+
+    std::lock_guard<std::mutex> l(lock);
+    done = true;
+    wait.notify_all();
+  });
+}
+
+RSP::stream::~stream() {
+  if (worker.joinable()) {
+    {
+      std::lock_guard<std::mutex> l(lock);
+      stop = true;
+      wait.notify_all();
+    }
+
+    worker.join();
+  }
+
+  if (f)
+    fclose(f);
+}
+
+bool RSP::stream::read(std::string &block) {
+  std::unique_lock<std::mutex> l(lock);
+  wait.wait(l, [this]() { return blocks.size() || done || failed; });
+
+  if (blocks.empty())
+    return false;
+
+  block = std::move(blocks.front());
+  blocks.pop_front();
+  wait.notify_all();
+
+  return true;
+}
+
+RSP::data RSP::loadF(std::string file, RSP::format c, bool validate, unsigned int threads)
+{
+  RSP::stream s(file);
+  std::string fData, block;
+
+  fData.reserve(s.size);
+
+  while (s.read(block))
+    fData += block;
+
+  if (s.failed) {
+    #ifndef RSP_QUIET_ERRORS
+    printf("RSP::loadF :: %s \"%s\"\n", s.error.c_str(), file.c_str()); // print error
+    #endif /*RSP_QUIET_ERRORS*/
+
+    return {"RSP-ERROR", s.error};
+  }
+
+  return loadS(fData, c, validate, threads);
+}
+
+RSP::loader &RSP::loader::operator=(RSP::loader &&other) {
+  if (this != &other) {
+    for (auto &t : threads)
+      if (t.joinable())
+        t.join();
+
+    files = std::move(other.files);
+    threads = std::move(other.threads);
+  }
+
+  return *this;
+}
+
+RSP::loader::~loader() {
+  for (auto &t : threads)
+    if (t.joinable())
+      t.join();
+}
+
+RSP::loader RSP::loadManyAsync(std::vector<std::string> files, RSP::format c, unsigned int threads) {
+  struct pool {
+    std::vector<std::string> files;
+    std::vector<std::promise<RSP::data>> results;
+    std::atomic<size_t> next{0}; // next file to load
+  }; // state shared by the workers
+
+  auto p = std::make_shared<pool>();
+  p->files = std::move(files);
+  p->results.resize(p->files.size());
+
+  RSP::loader output;
+  for (auto &r : p->results)
+    output.files.push_back(r.get_future());
+
+  if (!threads)
+    threads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+  if (threads > p->files.size())
+    threads = p->files.size();
+
+  for (size_t i = 0; i < threads && i < p->files.size(); i++) // read-ahead the first batch
+    RSPreadahead(p->files[i]);
+
+  for (unsigned int t = 0; t < threads; t++) {
+    output.threads.emplace_back([p, c, threads]() {
+      for (size_t i = p->next++; i < p->files.size(); i = p->next++) {
+        if (i + threads < p->files.size()) // read-ahead the file this worker will likely get next
+          RSPreadahead(p->files[i + threads]);
+
+        try {
+          p->results[i].set_value(loadF(p->files[i], c));
+        } catch (...) {
+          p->results[i].set_exception(std::current_exception());
+        }
+      }
+    });
+  }
+
+  return output;
+}
+
+std::vector<RSP::data> RSP::loadMany(std::vector<std::string> files, RSP::format c, unsigned int threads) {
+  std::vector<RSP::data> output;
+
+  RSP::loader l = loadManyAsync(std::move(files), c, threads);
+
+  for (auto &f : l.files)
+    output.push_back(f.get());
+
+  return output;
+}
+
+bool RSPstartsWith(std::string_view data, size_t i, const char *str) { // case insensitive check for str (lowercase ASCII, like a tag name) at i
+  for (size_t j = 0; str[j]; j++)
+    if (i + j >= data.size() || tolower((unsigned char)data[i + j]) != str[j])
+      return false;
+
+  return true;
+}
+
+RSP::detection RSP::detect(std::string_view data, size_t limit) {
+  data = data.substr(0, limit);
+
+  size_t i = 0;
+
+  if (!data.compare(0, 3, "\xef\xbb\xbf")) // utf-8 BOM
+    i = 3;
+
+  if (!data.compare(0, 2, "\x1f\x8b") || !data.compare(0, 4, "\x28\xb5\x2f\xfd"))
+    return {GUESS, 0}; // compressed, loadF decompresses it first
+
+  i = data.find_first_not_of(" \t\r\n", i);
+
+  if (i >= data.size())
+    return {GUESS, 0};
+
+  if (data[i] == '<') {
+    // skip the xml declaration, comments and doctype, looking for the first tag
+    bool declared = RSPstartsWith(data, i, "<?xml");
+
+    for (size_t j = i; j < data.size(); j = data.find('<', j + 1)) {
+      if (RSPstartsWith(data, j, "<!doctype html") || RSPstartsWith(data, j, "<html"))
+        return {HTML, 0.95f};
+      if (RSPstartsWith(data, j, "<svg"))
+        return {SVG, 0.95f};
+      if (RSPstartsWith(data, j, "<!--")) {
+        j = data.find("-->", j);
+
+        if (j >= data.size())
+          break;
+      }
+      else if (j + 1 < data.size() && data[j + 1] != '!' && data[j + 1] != '?') // the root tag
+        return {XML, declared ? 0.95f : 0.8f};
+    }
+
+    return {XML, declared ? 0.9f : 0.6f};
+  }
+
+  if (data[i] == '{' || data[i] == '[') {
+    size_t next = data.find_first_not_of(" \t\r\n", i + 1);
+    bool likely = next < data.size() && strchr(data[i] == '{' ? "\"}" : "\"{[]-0123456789tfn", data[next]);
+
+    // more than one line starting with {, NDJSON
+    size_t line = data.find('\n', i);
+    if (data[i] == '{' && line < data.size()) {
+      size_t end = data.find_last_not_of(" \t\r", line - 1);
+      size_t nextLine = data.find_first_not_of(" \t\r\n", line);
+
+      if (end < data.size() && data[end] == '}' && nextLine < data.size() && data[nextLine] == '{')
+        return {NDJSON, 0.85f};
+    }
+
+    return {JSON, likely ? 0.9f : 0.6f};
+  }
+
+  // CSV, look for a divider that shows up the same number of times on each line (outside of quotes)
+  size_t commas = 0, semis = 0, lineCommas = 0, lineSemis = 0, lines = 0;
+  bool same = true, inQuotes = false;
+
+  for (size_t j = i; j < data.size(); j++) {
+    char ch = data[j];
+
+    if (ch == '"')
+      inQuotes = !inQuotes;
+    else if (inQuotes)
+      continue;
+    else if (ch == ',')
+      commas++;
+    else if (ch == ';')
+      semis++;
+    else if (ch == '\n') {
+      if (lines && (commas != lineCommas || semis != lineSemis))
+        same = false;
+
+      lineCommas = commas;
+      lineSemis = semis;
+      commas = semis = 0;
+      lines++;
+    }
+  }
+
+  if (!lines) { // one (maybe cut off) line
+    lineCommas = commas;
+    lineSemis = semis;
+  }
+
+  if (!lineCommas && !lineSemis)
+    return {CSV_GUESS, 0.1f};
+
+  return {(lineSemis > lineCommas) ? CSV_SEMI : CSV_COMMA, (lines > 1 && same) ? 0.85f : 0.5f};
+}
+
+RSP::data RSP::loadS(std::string data, RSP::format c, bool validate, unsigned int threads){
+  if (c == GUESS)
+    c = detect(data).c;
+
+  if (c == GUESS) {
+    #ifndef RSP_QUIET_ERRORS
+    printf("RSP::loadS :: Failed to guess the format\n"); // print error
+    #endif /*RSP_QUIET_ERRORS*/
+
+    return {"RSP-ERROR", "Failed to guess the format"};
+  }
+
+  if (!data.compare(0, 3, "\xef\xbb\xbf")) // utf-8 BOM, detect skips it, so the tokenizers have to as well
+    data.erase(0, 3);
+
+  if (c == NDJSON) { // each line is its own JSON value
+    RSP::data output;
+
+    for (size_t i = 0, end; i < data.size(); i = end + 1) {
+      end = std::min(data.find('\n', i), data.size());
+
+      if (data.find_first_not_of(" \t\r", i) < end)
+        output.list.push_back(loadS(data.substr(i, end - i), JSON));
+    }
+
+    return output;
+  }
+
+  if ((c == SVG || c == XML || c == HTML) && threads != 1 && !validate)
+    return parseXMLParallel(data, c, threads);
+
+  if (c != CSV_COMMA && c != CSV_SEMI && c != CSV_GUESS) // remove the newlines, in one pass
+    data.erase(std::remove(data.begin(), data.end(), '\n'), data.end());
+
+  std::string error;
+  std::vector<RSP::token> tokens;
+
+  if (c == SVG || c == XML || c == HTML)
+    tokens = tokenizeXML(data, c, validate ? &error : NULL);
+  else if (c == JSON)
+    tokens = tokenizeJSON(data, validate ? &error : NULL);
+  else
+    return parseCSV(tokenizeCSV(data, c));
+
+  if (error.size()) {
+    #ifndef RSP_QUIET_ERRORS
+    printf("RSP::loadS :: %s\n", error.c_str()); // print error
+    #endif /*RSP_QUIET_ERRORS*/
+
+    return {"RSP-ERROR", error};
+  }
+
+  if (c == JSON)
+    return parseJSON(tokens);
+
+  return parseXML(tokens, c);
+}
+
+void RSP::dumpF(std::string file, RSP::data d, RSP::format c) {
+  std::string dStr = dumpF(d, c);
+
+  FILE *f = fopen(file.c_str(), "w+");
+
+  fwrite(dStr.c_str(), 1, dStr.size(), f);
+
+  fclose(f);
+}
+
+bool RSPisLiteral(const std::string &value) { // true if the value is a JSON number, true, false or null
+  if (value == "true" || value == "false" || value == "null")
+    return true;
+
+  size_t i = (value[0] == '-');
+
+  auto digits = [&]() { // skip digits, returns how many there were
+    size_t start = i;
+    while (i < value.size() && isdigit((unsigned char)value[i]))
+      i++;
+
+    return i - start;
+  };
+
+  if (value[i] == '0') // no leading zeros
+    i++;
+  else if (!digits())
+    return false;
+
+  if (value[i] == '.' && (i++, !digits())) // a digit on both sides of the .
+    return false;
+
+  if (value[i] == 'e' || value[i] == 'E') {
+    i++;
+
+    if (value[i] == '+' || value[i] == '-')
+      i++;
+
+    if (!digits())
+      return false;
+  }
+
+  return i == value.size();
+}
+
+void RSPjsonStr(RSP::data d, std::string &str) {
+  int i = 0;
+
+  for (auto &n : d.next)
+  {
+    i++;
+
+    n.key = "\"" + RSP::escape(n.key, RSP::JSON) + "\"";
+
+    if (n.next.size())
+    {
+      str += "\n\n" + n.key + " : " + " {";
+      RSPjsonStr(n, str);
+      str += "\n}";
+    }
+
+    else if (!n.quoted && RSPisLiteral(n.value))
+      str += "\n" + n.key + ":" + n.value;
+
+    else
+      str += "\n" + n.key + ":\"" + RSP::escape(n.value, RSP::JSON) + "\"";
+
+    if (i < d.next.size())
+      str += ",";
+  }
+}
+
+void RSPXMLStr(RSP::data d, std::string &str)
+{
+  for (auto &n : d.next)
+  {
+    str += "<" + n.key;
+
+    for (auto &a : n.args)
+      str += " " + a.first + "=\"" + RSP::escape(a.second, RSP::XML) + "\"";
+
+    str += ">\n";
+
+    str += RSP::escape(n.value, RSP::XML) + "\n";
+
+    if (n.next.size())
+    {
+      str += "\n";
+      RSPXMLStr(n, str);
+    }
+
+    str += "</" + n.key + ">\n";
+  }
+}
+
+std::string RSP::dumpF(RSP::data d, RSP::format c)
+{
+  std::string output;
+
+  if (c == JSON)
+  {
+    output += "{";
+    RSPjsonStr(d, output);
+    output += "\n\n}";
+  }
+
+  else if (c == HTML || c == XML || c == SVG) {
+    output += "<!DOCTYPE " + (std::string)((c == HTML) ? "html" : (c == XML) ? "xml"
+                                                                             : "svg") +
+              ">\n";
+
+    RSPXMLStr(d, output);
+  }
+
+  return output;
+}
+
+bool RSPequal(const RSP::data &a, const RSP::data &b) { // check if two nodes (and everything under them) are the same
+  if (a.key != b.key || a.value != b.value || a.args != b.args || a.list.size() != b.list.size() || a.next.size() != b.next.size())
+    return false;
+
+  for (size_t i = 0; i < a.list.size(); i++)
+    if (!RSPequal(a.list[i], b.list[i]))
+      return false;
+
+  for (size_t i = 0; i < a.next.size(); i++)
+    if (!RSPequal(a.next[i], b.next[i]))
+      return false;
+
+  return true;
+}
+
+bool RSPsame(const RSP::data &a, const RSP::data &b) { // check if a node's own data (not next) is the same
+  if (a.value != b.value || a.args != b.args || a.list.size() != b.list.size())
+    return false;
+
+  for (size_t i = 0; i < a.list.size(); i++)
+    if (!RSPequal(a.list[i], b.list[i]))
+      return false;
+
+  return true;
+}
+
+// get the changes between a and b, if merge is true, b's new and changed parts are moved into a (so unchanged nodes of a are kept)
+void RSPdiff(RSP::data &a, RSP::data &b, const std::string &path, std::vector<RSP::change> &changes, bool merge) {
+  if (!RSPsame(a, b)) {
+    changes.push_back({RSP::changed, path});
+
+    if (merge) {
+      a.value = std::move(b.value);
+      a.args = std::move(b.args);
+      a.list = std::move(b.list);
+    }
+  }
+
+  std::string prefix = path.size() ? path + "/" : "";
+
+  // match children by key, and by how many times the key was already seen (for repeated XML tags)
+  std::map<std::string, std::vector<size_t>> aKeys;
+  for (size_t i = 0; i < a.next.size(); i++)
+    aKeys[a.next[i].key].push_back(i);
+
+  std::map<std::string, size_t> seen;
+  std::vector<bool> used(a.next.size(), false);
+  std::vector<size_t> match(b.next.size(), a.next.size()); // index of each of b's children in a (a.next.size() if it's new)
+  bool sameOrder = (a.next.size() == b.next.size());
+
+  for (size_t j = 0; j < b.next.size(); j++) {
+    RSP::data &n = b.next[j];
+    size_t count = seen[n.key]++;
+    std::string p = prefix + n.key + (count ? "[" + std::to_string(count) + "]" : "");
+
+    auto k = aKeys.find(n.key);
+
+    if (k == aKeys.end() || count >= k->second.size()) {
+      changes.push_back({RSP::added, p});
+      sameOrder = false;
+      continue;
+    }
+
+    match[j] = k->second[count];
+    used[match[j]] = true;
+    sameOrder = sameOrder && match[j] == j;
+
+    RSPdiff(a.next[match[j]], n, p, changes, merge);
+  }
+
+  seen.clear();
+
+  for (size_t i = 0; i < a.next.size(); i++) {
+    size_t count = seen[a.next[i].key]++;
+
+    if (!used[i])
+      changes.push_back({RSP::removed, prefix + a.next[i].key + (count ? "[" + std::to_string(count) + "]" : "")});
+  }
+
+  if (merge && !sameOrder) { // children were added, removed or moved, rebuild next (moving the nodes, so their memory is reused)
+    std::vector<RSP::data> next;
+    next.reserve(b.next.size());
+
+    for (size_t j = 0; j < b.next.size(); j++)
+      next.push_back(std::move((match[j] < a.next.size()) ? a.next[match[j]] : b.next[j]));
+
+    a.next = std::move(next);
+  }
+}
+
+std::vector<RSP::change> RSP::diff(RSP::data &a, RSP::data &b) {
+  std::vector<RSP::change> changes;
+  RSPdiff(a, b, "", changes, false);
+
+  return changes;
+}
+
+bool RSPreadAll(const std::string &file, std::string &output) { // read a whole (maybe compressed) file
+  RSP::stream s(file);
+  std::string block;
+
+  output.clear();
+  output.reserve(s.size);
+
+  while (s.read(block))
+    output += block;
+
+  return !s.failed;
+}
+
+unsigned long long RSPhash(const std::string &str) { // FNV-1a hash
+  unsigned long long hash = 14695981039346656037ULL;
+
+  for (unsigned char ch : str)
+    hash = (hash ^ ch) * 1099511628211ULL;
+
+  return hash;
+}
+
+RSP::watcher::watcher(std::string file, RSP::format c) : file(file), c(c) {
+  std::string fData;
+
+  if (RSPreadAll(file, fData)) {
+    hash = RSPhash(fData);
+    tree = loadS(fData, c);
+  }
+  else
+    tree = loadF(file, c); // prints the error and returns the error data
+
+  #ifdef __linux__
+  // watch the directory, editors often replace the file instead of writing to it
+  std::string dir = (file.find_last_of('/') < file.size()) ? file.substr(0, file.find_last_of('/')) : ".";
+
+  fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+  if (fd >= 0)
+    wd = inotify_add_watch(fd, dir.empty() ? "/" : dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+  #endif /*__linux__*/
+}
+
+RSP::watcher::~watcher() {
+  #ifdef __linux__
+  if (fd >= 0)
+    ::close(fd);
+  #endif /*__linux__*/
+}
+
+void RSP::watcher::subscribe(std::string path, std::function<void(const RSP::change &)> f) {
+  subscribers.push_back({path, f});
+}
+
+bool RSP::watcher::poll(int timeout) {
+  #ifdef __linux__
+  if (fd >= 0 && wd >= 0) {
+    pollfd p = {fd, POLLIN, 0};
+
+    if (::poll(&p, 1, timeout) <= 0)
+      return false;
+
+    // check if any of the events are for our file
+    std::string name = file.substr(file.find_last_of('/') < file.size() ? file.find_last_of('/') + 1 : 0);
+    bool ours = false;
+    alignas(inotify_event) char buffer[4096];
+    ssize_t size;
+
+    while ((size = ::read(fd, buffer, sizeof(buffer))) > 0) {
+      for (char *e = buffer; e < buffer + size; e += sizeof(inotify_event) + ((inotify_event *)e)->len) {
+        inotify_event *event = (inotify_event *)e;
+
+        if (event->len && name == event->name)
+          ours = true;
+      }
+    }
+
+    if (!ours)
+      return false;
+  }
+  else
+  #endif /*__linux__*/
+  if (timeout > 0) // no inotify, check the file every timeout ms
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+
+  std::string fData;
+
+  if (!RSPreadAll(file, fData))
+    return false;
+
+  unsigned long long newHash = RSPhash(fData);
+
+  if (newHash == hash) // same contents, nothing to do
+    return false;
+
+  hash = newHash;
+
+  RSP::data newTree = loadS(fData, c);
+  std::vector<RSP::change> changes;
+
+  RSPdiff(tree, newTree, "", changes, true);
+
+  if (tree.key != newTree.key) {
+    changes.push_back({RSP::changed, ""});
+    tree.key = newTree.key;
+  }
+
+  for (auto &ch : changes) {
+    for (auto &s : subscribers) {
+      const std::string &a = ch.path, &b = s.first;
+
+      // tell subscribers about changes at, under or above their path
+      bool under = !b.size() || (a.compare(0, b.size(), b) == 0 && (a.size() == b.size() || a[b.size()] == '/'));
+      bool above = !a.size() || (b.compare(0, a.size(), a) == 0 && b[a.size()] == '/');
+
+      if (under || above)
+        s.second(ch);
+    }
+  }
+
+  return changes.size();
+}
+
+// streaming readers, they read a stream block by block and send JSON style tokens (open, close, openList, closeList, key, value) to emit
+// keys are decoded, values are kept as JSON (strings keep their quotes and escapes)
+
+bool RSPstreamJSON(RSP::stream &in, std::function<void(RSP::token &)> emit) {
+  std::string block, cur;
+  std::vector<char> stack; // '{' or '['
+  bool inString = false, escaped = false, expectKey = false;
+
+  auto send = [&](RSP::tokenType t, std::string data = "") {
+    RSP::token tok = {t, data};
+    emit(tok);
+  };
+
+  auto flush = [&]() { // send a number, true, false or null
+    if (cur.size())
+      send(RSP::value, cur);
+
+    cur.clear();
+  };
+
+  while (in.read(block)) {
+    for (char ch : block) {
+      if (inString) {
+        cur += ch;
+
+        if (escaped)
+          escaped = false;
+        else if (ch == '\\')
+          escaped = true;
+        else if (ch == '"') {
+          inString = false;
+
+          if (expectKey)
+            RSPdecode(cur, RSP::JSON);
+
+          send(expectKey ? RSP::key : RSP::value, cur);
+          cur.clear();
+        }
+
+        continue;
+      }
+
+      switch (ch) {
+        case '"':
+          flush();
+          inString = true;
+          cur = "\"";
+          break;
+        case '{':
+        case '[':
+          flush();
+          send(ch == '{' ? RSP::open : RSP::openList);
+          stack.push_back(ch);
+          expectKey = (ch == '{');
+          break;
+        case '}':
+        case ']':
+          flush();
+          send(ch == '}' ? RSP::close : RSP::closeList);
+
+          if (stack.size())
+            stack.pop_back();
+
+          expectKey = false;
+          break;
+        case ':':
+          flush();
+          expectKey = false;
+          break;
+        case ',':
+          flush();
+          expectKey = (stack.size() && stack.back() == '{');
+          break;
+        case ' ': case '\t': case '\r': case '\n':
+          flush();
+          break;
+        default:
+          cur += ch;
+          break;
+      }
+    }
+  }
+
+  flush();
+  return !in.failed;
+}
+
+struct RSPcsvReader {
+  std::function<void(std::vector<std::string> &, std::vector<bool> &)> record; // gets each record's fields (the header too), and if they were quoted
+  char s = ',';          // divider
+  bool guessing = false; // true if the divider is guessed from the first line
+
+  std::string field, firstLine;
+  std::vector<std::string> fields;
+  std::vector<bool> quotedFields;
+  bool inQuotes = false, quoted = false, lastQuote = false;
+
+  RSPcsvReader(RSP::format c, std::function<void(std::vector<std::string> &, std::vector<bool> &)> record) : record(record) {
+    s = (c == RSP::CSV_SEMI) ? ';' : ',';
+    guessing = (c == RSP::CSV_GUESS);
+  }
+
+  void endField() {
+    fields.push_back(field);
+    quotedFields.push_back(quoted);
+    field.clear();
+    quoted = false;
+  }
+
+  void endRecord() {
+    endField();
+
+    if (!(fields.size() == 1 && fields[0].empty() && !quotedFields[0])) // skip blank lines
+      record(fields, quotedFields);
+
+    fields.clear();
+    quotedFields.clear();
+  }
+
+  void feed(char ch) {
+    if (inQuotes) {
+      if (ch == '"')
+        inQuotes = false, lastQuote = true;
+      else
+        field += ch;
+      return;
+    }
+
+    if (ch == '"') {
+      if (lastQuote) // "" is an escaped "
+        field += '"';
+
+      inQuotes = quoted = true;
+      lastQuote = false;
+      return;
+    }
+
+    lastQuote = false;
+
+    if (ch == s)
+      endField();
+    else if (ch == '\n')
+      endRecord();
+    else if (ch != '\r')
+      field += ch;
+  }
+
+  void guess() { // pick the divider that shows up the most in the first line, then read the line
+    s = (std::count(firstLine.begin(), firstLine.end(), ';') > std::count(firstLine.begin(), firstLine.end(), ',')) ? ';' : ',';
+    guessing = false;
+    inQuotes = false;
+
+    for (char ch : firstLine)
+      feed(ch);
+
+    firstLine.clear();
+  }
+
+  void read(const char *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      char ch = data[i];
+
+      if (!guessing) {
+        feed(ch);
+        continue;
+      }
+
+      // hold the first line until it's done, so the divider can be guessed
+      firstLine += ch;
+
+      if (ch == '"')
+        inQuotes = !inQuotes;
+      else if (ch == '\n' && !inQuotes)
+        guess();
+    }
+  }
+
+  void finish() {
+    if (guessing)
+      guess();
+
+    if (field.size() || fields.size())
+      endRecord();
+  }
+}; // reads CSV records piece by piece
+
+bool RSPstreamCSV(RSP::stream &in, RSP::format c, std::function<void(RSP::token &)> emit) {
+  std::vector<std::string> header;
+  bool haveHeader = false;
+
+  auto send = [&](RSP::tokenType t, std::string data = "") {
+    RSP::token tok = {t, data};
+    emit(tok);
+  };
+
+  RSPcsvReader reader(c, [&](std::vector<std::string> &fields, std::vector<bool> &quoted) {
+    if (!haveHeader) {
+      header = fields;
+      haveHeader = true;
+      return;
+    }
+
+    send(RSP::open);
+
+    for (size_t i = 0; i < fields.size(); i++) {
+      send(RSP::key, (i < header.size()) ? header[i] : std::to_string(i));
+
+      if (!quoted[i] && RSPisLiteral(fields[i]))
+        send(RSP::value, fields[i]);
+      else
+        send(RSP::value, "\"" + RSP::escape(fields[i], RSP::JSON) + "\"");
+    }
+
+    send(RSP::close);
+  });
+
+  std::string block;
+
+  send(RSP::openList);
+
+  while (in.read(block))
+    reader.read(block.data(), block.size());
+
+  reader.finish();
+
+  send(RSP::closeList);
+  return !in.failed;
+}
+
+bool RSPstreamXML(RSP::stream &in, RSP::format c, std::function<void(RSP::token &)> emit) { // sends XML tokens (open with args, close, content)
+  const std::vector<std::string> &voidTags = (c == RSP::HTML) ? RSPhtmlVoidTags : RSP::voidTags;
+  std::string block, buf;
+  bool inTag = false;
+  char quote = 0;
+
+  auto text = [&]() { // send the text between tags
+    size_t start = buf.find_first_not_of(" \t\r\n"), end = buf.find_last_not_of(" \t\r\n");
+
+    if (start < buf.size()) {
+      RSP::token t = {RSP::content, buf.substr(start, end - start + 1)};
+      RSPdecode(t.data, c, false);
+      emit(t);
+    }
+  };
+
+  auto tag = [&]() { // send a tag (buf holds everything between < and >)
+    if (!buf.compare(0, 8, "![CDATA[")) {
+      RSP::token t = {RSP::content, buf.substr(8, buf.size() - 10)};
+      emit(t);
+      return;
+    }
+
+    if (buf.empty() || buf[0] == '!' || buf[0] == '?') // comment, doctype or xml declaration
+      return;
+
+    bool close = (buf[0] == '/'), selfClose = (buf.back() == '/');
+    size_t i = close ? 1 : 0;
+    size_t nameEnd = std::min(buf.find_first_of(" \t\r\n/", i), buf.size());
+
+    RSP::token t = {close ? RSP::close : RSP::open, buf.substr(i, nameEnd - i)};
+
+    for (i = nameEnd; !close && i < buf.size();) { // get the args
+      i = buf.find_first_not_of(" \t\r\n/", i);
+      if (i >= buf.size())
+        break;
+
+      size_t keyEnd = std::min(buf.find_first_of(" \t\r\n=/", i), buf.size());
+      std::string key = buf.substr(i, keyEnd - i), value;
+
+      i = buf.find_first_not_of(" \t\r\n", keyEnd);
+
+      if (i < buf.size() && buf[i] == '=') {
+        i = buf.find_first_not_of(" \t\r\n", i + 1);
+
+        if (i < buf.size() && (buf[i] == '"' || buf[i] == '\'')) {
+          size_t end = std::min(buf.find(buf[i], i + 1), buf.size());
+          value = buf.substr(i + 1, end - i - 1);
+          i = end + 1;
+        }
+        else if (i < buf.size()) {
+          size_t end = std::min(buf.find_first_of(" \t\r\n", i), buf.size());
+          value = buf.substr(i, end - i);
+          i = end;
+        }
+      }
+
+      RSPdecode(value, c, false);
+      t.args[key] = value;
+    }
+
+    emit(t);
+
+    if (!close && (selfClose || std::find(voidTags.begin(), voidTags.end(), t.data) != voidTags.end())) {
+      RSP::token end = {RSP::close, t.data};
+      emit(end);
+    }
+  };
+
+  while (in.read(block)) {
+    for (char ch : block) {
+      if (!inTag) {
+        if (ch == '<') {
+          text();
+          buf.clear();
+          inTag = true;
+        }
+        else
+          buf += ch;
+
+        continue;
+      }
+
+      if (quote) {
+        buf += ch;
+
+        if (ch == quote)
+          quote = 0;
+        continue;
+      }
+
+      if (ch == '>') {
+        // comments and CDATA end with --> and ]]>, the > alone doesn't end them
+        bool comment = !buf.compare(0, 3, "!--") && (buf.size() < 5 || buf.compare(buf.size() - 2, 2, "--"));
+        bool cdata = !buf.compare(0, 8, "![CDATA[") && (buf.size() < 10 || buf.compare(buf.size() - 2, 2, "]]"));
+
+        if (!comment && !cdata) {
+          tag();
+          buf.clear();
+          inTag = false;
+          continue;
+        }
+      }
+      else if ((ch == '"' || ch == '\'') && buf.size() && buf[0] != '!') // quoted arg values can have > in them
+        quote = ch;
+
+      buf += ch;
+    }
+  }
+
+  return !in.failed;
+}
+
+struct RSPxmlToJSON {
+  std::function<void(RSP::token &)> emit; // where JSON style tokens go
+
+  struct element {
+    std::string name, text;
+    std::map<std::string, std::string> args;
+  };
+
+  struct level {
+    std::string list, text; // list : name of the list that's open in this object, text : its text runs, sent as one "#text"
+    element held;           // the last child if it was a leaf, held back until we know if the next one has the same name
+    bool holding = false;
+  }; // an object that's open
+
+  std::vector<level> stack;
+  element pending; // the element that's open, but hasn't been sent yet (we don't know if it has children)
+  bool isPending = false;
+
+  void send(RSP::tokenType t, std::string data = "") {
+    RSP::token tok = {t, data};
+    emit(tok);
+  }
+
+  void sendString(const std::string &str) { // text that's a JSON number, true, false or null is sent bare, like the CSV reader does
+    if (RSPisLiteral(str))
+      send(RSP::value, str);
+    else
+      send(RSP::value, "\"" + RSP::escape(str, RSP::JSON) + "\"");
+  }
+
+  void sendArgs(element &e) {
+    for (auto &arg : e.args) {
+      send(RSP::key, "@" + arg.first);
+      sendString(arg.second);
+    }
+  }
+
+  void addText(std::string &text, const std::string &run) { // the reader trims the runs, so join them with a space
+    if (text.size() && run.size())
+      text += " ";
+
+    text += run;
+  }
+
+  void startList(const std::string &name) { // the next children go in a list called name
+    if (stack.back().list == name)
+      return;
+
+    endList();
+    send(RSP::key, name);
+    send(RSP::openList);
+    stack.back().list = name;
+  }
+
+  void endList() {
+    if (stack.back().list.size())
+      send(RSP::closeList);
+
+    stack.back().list.clear();
+  }
+
+  void release() { // send the held back leaf, <a>text</a> becomes "a" : "text"
+    level &l = stack.back();
+
+    if (!l.holding)
+      return;
+
+    if (l.list != l.held.name) {
+      endList();
+      send(RSP::key, l.held.name);
+    }
+
+    if (l.held.args.empty())
+      sendString(l.held.text);
+    else {
+      send(RSP::open);
+      sendArgs(l.held);
+
+      if (l.held.text.size()) {
+        send(RSP::key, "#text");
+        sendString(l.held.text);
+      }
+
+      send(RSP::close);
+    }
+
+    l.holding = false;
+  }
+
+  void openPending() { // the element has children, so it becomes an object
+    if (stack.back().list != pending.name) {
+      if (stack.size() > 1) // in a list, so the siblings after it with the same name can join it
+        startList(pending.name);
+      else { // the root element can't repeat
+        endList();
+        send(RSP::key, pending.name);
+      }
+    }
+
+    send(RSP::open);
+    sendArgs(pending);
+
+    stack.push_back({});
+    stack.back().text = std::move(pending.text);
+    isPending = false;
+  }
+
+  void closeLevel() {
+    release();
+    endList();
+
+    if (stack.back().text.size()) {
+      send(RSP::key, "#text");
+      sendString(stack.back().text);
+    }
+
+    send(RSP::close);
+    stack.pop_back();
+  }
+
+  void operator()(RSP::token &t) {
+    if (stack.empty()) { // everything goes in one object
+      send(RSP::open);
+      stack.push_back({});
+    }
+
+    switch (t.t) {
+      case RSP::open:
+        if (isPending)
+          openPending();
+
+        if (stack.back().holding && stack.back().held.name == t.data) // repeated leaves go in a list
+          startList(t.data);
+
+        release();
+
+        pending = {std::move(t.data), "", std::move(t.args)};
+        isPending = true;
+        break;
+      case RSP::content:
+        addText(isPending ? pending.text : stack.back().text, t.data);
+        break;
+      case RSP::close:
+        if (isPending) { // no children, hold it back in case the next sibling has the same name
+          stack.back().held = std::move(pending);
+          stack.back().holding = true;
+          isPending = false;
+        }
+        else if (stack.size() > 1)
+          closeLevel();
+        break;
+      default:
+        break;
+    }
+  }
+
+  void finish() {
+    if (isPending) { // unclosed element
+      stack.back().held = std::move(pending);
+      stack.back().holding = true;
+      isPending = false;
+    }
+
+    while (stack.size())
+      closeLevel();
+  }
+}; // turns XML tokens into JSON style tokens
+
+struct RSPjsonWriter {
+  std::function<void(const std::string &)> out;
+  bool ndjson = false;
+
+  std::string buf;         // output that hasn't been sent yet
+  std::vector<bool> empty; // for each open object/list, true if nothing's in it yet
+  bool afterKey = false, topList = false, wrote = false;
+
+  void write(const std::string &str) {
+    buf += str;
+
+    if (buf.size() >= (1 << 16))
+      flush();
+  }
+
+  void flush() {
+    if (buf.size())
+      out(buf);
+
+    buf.clear();
+  }
+
+  void indent() {
+    if (!ndjson)
+      write("\n" + std::string(empty.size() * 2, ' '));
+  }
+
+  void separate() { // write what goes before a key or value, a comma, or a newline between NDJSON records
+    if (afterKey) {
+      afterKey = false;
+      return;
+    }
+
+    if (empty.empty()) { // top level
+      if (wrote && !ndjson)
+        write("\n");
+
+      wrote = true;
+      return;
+    }
+
+    if (ndjson && topList && empty.size() == 1) { // a record of the top level list
+      empty.back() = false;
+      return;
+    }
+
+    if (!empty.back())
+      write(",");
+
+    empty.back() = false;
+    indent();
+  }
+
+  void operator()(RSP::token &t) {
+    switch (t.t) {
+      case RSP::open:
+      case RSP::openList:
+        separate();
+
+        if (ndjson && empty.empty() && t.t == RSP::openList) // the top level list is split into lines
+          topList = true;
+        else
+          write(t.t == RSP::open ? "{" : "[");
+
+        empty.push_back(true);
+        break;
+      case RSP::close:
+      case RSP::closeList: {
+        if (empty.empty())
+          break;
+
+        bool wasEmpty = empty.back();
+        empty.pop_back();
+
+        if (ndjson && topList && empty.empty()) {
+          topList = false;
+          break;
+        }
+
+        if (!wasEmpty)
+          indent();
+
+        write(t.t == RSP::close ? "}" : "]");
+
+        if (ndjson && (empty.empty() || (topList && empty.size() == 1))) // end of a record
+          write("\n");
+        break;
+      }
+      case RSP::key:
+        separate();
+        write("\"" + RSP::escape(t.data, RSP::JSON) + (ndjson ? "\":" : "\" : "));
+        afterKey = true;
+        break;
+      case RSP::value:
+        separate();
+        write(t.data);
+
+        if (ndjson && (empty.empty() || (topList && empty.size() == 1)))
+          write("\n");
+        break;
+      default:
+        break;
+    }
+  }
+
+  void finish() {
+    if (wrote && !ndjson)
+      write("\n");
+
+    flush();
+  }
+}; // writes JSON style tokens as JSON or NDJSON
+
+struct RSPxmlWriter {
+  std::function<void(const std::string &)> out;
+
+  struct element {
+    std::string name;
+    bool list;      // a list, each value in it is written as its own <name>
+    bool synthetic; // <root> added to hold a top level list
+  };
+
+  std::string buf, name; // name : the last key
+  std::vector<element> stack;
+  size_t depth = 0;
+  bool tagOpen = false; // the last tag is missing its >, since args can still be added
+
+  void write(const std::string &str) {
+    buf += str;
+
+    if (buf.size() >= (1 << 16))
+      flush();
+  }
+
+  void flush() {
+    if (buf.size())
+      out(buf);
+
+    buf.clear();
+  }
+
+  std::string tagName() { // name for the next element
+    std::string tag = stack.empty() ? "root" : stack.back().list ? stack.back().name : name;
+
+    for (auto &ch : tag) // keep it a valid tag name
+      if (!isalnum((unsigned char)ch) && ch != '_' && ch != '-' && ch != '.' && ch != ':' && !(ch & 0x80))
+        ch = '_';
+
+    if (tag.empty() || isdigit((unsigned char)tag[0]) || tag[0] == '-' || tag[0] == '.')
+      tag.insert(tag.begin(), '_');
+
+    return tag;
+  }
+
+  void endTag() { // finish an open tag, once we know there are no more args for it
+    if (tagOpen)
+      write(">\n");
+
+    tagOpen = false;
+  }
+
+  void operator()(RSP::token &t) {
+    if (t.t == RSP::value && stack.size() && !stack.back().list && ((name[0] == '@' && tagOpen) || name == "#text")) {
+      std::string text = t.data;
+      RSPdecode(text, RSP::JSON);
+
+      if (name[0] == '@') // "@arg" : "value" is an arg, as the XML reader writes them (an arg after a child is written as an element)
+        write(" " + tagName().substr(1) + "=\"" + RSP::escape(text, RSP::XML) + "\"");
+      else {
+        endTag();
+        write(std::string(depth * 2, ' ') + RSP::escape(text, RSP::XML) + "\n");
+      }
+
+      return;
+    }
+
+    if (t.t != RSP::key)
+      endTag();
+
+    switch (t.t) {
+      case RSP::key:
+        name = t.data;
+        break;
+      case RSP::open: {
+        std::string tag = tagName();
+
+        write(std::string(depth * 2, ' ') + "<" + tag);
+        tagOpen = true;
+        stack.push_back({tag, false, false});
+        depth++;
+        break;
+      }
+      case RSP::close:
+        if (stack.empty())
+          break;
+
+        depth--;
+        write(std::string(depth * 2, ' ') + "</" + stack.back().name + ">\n");
+        stack.pop_back();
+        break;
+      case RSP::openList:
+        if (stack.empty()) { // a top level list needs an element to hold it
+          write("<root>\n");
+          stack.push_back({"root", false, true});
+          depth++;
+          stack.push_back({"item", true, false});
+        }
+        else
+          stack.push_back({tagName(), true, false});
+        break;
+      case RSP::closeList:
+        if (stack.empty())
+          break;
+
+        stack.pop_back();
+
+        if (stack.size() && stack.back().synthetic) {
+          depth--;
+          write("</root>\n");
+          stack.pop_back();
+        }
+        break;
+      case RSP::value: {
+        std::string tag = tagName();
+        std::string text = t.data;
+        RSPdecode(text, RSP::JSON);
+
+        write(std::string(depth * 2, ' ') + "<" + tag + ">" + RSP::escape(text, RSP::XML) + "</" + tag + ">\n");
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  void finish() {
+    endTag();
+    flush();
+  }
+}; // writes JSON style tokens as XML
+
+bool RSP::transcode(RSP::stream &in, RSP::format from, std::function<void(const std::string &)> out, RSP::format to) {
+  RSPjsonWriter json;
+  RSPxmlWriter xml;
+  std::function<void(RSP::token &)> writer;
+
+  if (to == JSON || to == NDJSON) {
+    json.out = out;
+    json.ndjson = (to == NDJSON);
+    writer = std::ref(json);
+  }
+  else if (to == XML || to == HTML || to == SVG) {
+    xml.out = out;
+    xml.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    writer = std::ref(xml);
+  }
+  else {
+    #ifndef RSP_QUIET_ERRORS
+    printf("RSP::transcode :: Can only write JSON, NDJSON or XML\n"); // print error
+    #endif /*RSP_QUIET_ERRORS*/
+
+    return false;
+  }
+
+  bool ok;
+
+  if (from == XML || from == HTML || from == SVG) {
+    RSPxmlToJSON convert = {writer};
+
+    ok = RSPstreamXML(in, from, std::ref(convert));
+    convert.finish();
+  }
+  else if (from == JSON)
+    ok = RSPstreamJSON(in, writer);
+  else if (from == NDJSON) { // the records are read as one list
+    RSP::token list = {openList};
+    writer(list);
+
+    ok = RSPstreamJSON(in, writer);
+
+    list.t = closeList;
+    writer(list);
+  }
+  else if (from == CSV_COMMA || from == CSV_SEMI || from == CSV_GUESS)
+    ok = RSPstreamCSV(in, from, writer);
+  else {
+    #ifndef RSP_QUIET_ERRORS
+    printf("RSP::transcode :: Unknown input format\n"); // print error
+    #endif /*RSP_QUIET_ERRORS*/
+
+    return false;
+  }
+
+  if (to == JSON || to == NDJSON)
+    json.finish();
+  else
+    xml.finish();
+
+  if (!ok) {
+    #ifndef RSP_QUIET_ERRORS
+    printf("RSP::transcode :: %s\n", in.error.c_str()); // print error
+    #endif /*RSP_QUIET_ERRORS*/
+  }
+
+  return ok;
+}
+
+RSP::format RSPformatOf(std::string file) { // guess a file's format from its extension
+  for (const char *ext : {".gz", ".zst"}) // the file's compression doesn't matter
+    if (file.size() > strlen(ext) && !file.compare(file.size() - strlen(ext), strlen(ext), ext))
+      file.erase(file.size() - strlen(ext));
+
+  std::string ext = file.substr(std::min(file.find_last_of('.') + 1, file.size()));
+  std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+  if (ext == "json") return RSP::JSON;
+  if (ext == "ndjson" || ext == "jsonl") return RSP::NDJSON;
+  if (ext == "xml") return RSP::XML;
+  if (ext == "html" || ext == "htm") return RSP::HTML;
+  if (ext == "svg") return RSP::SVG;
+  if (ext == "csv") return RSP::CSV_GUESS;
+
+  return RSP::GUESS;
+}
+
+bool RSP::transcode(std::string in, std::string out, RSP::format from, RSP::format to) {
+  if (from == GUESS)
+    from = RSPformatOf(in);
+  if (to == GUESS)
+    to = RSPformatOf(out);
+
+  if (from == GUESS || to == GUESS) {
+    #ifndef RSP_QUIET_ERRORS
+    printf("RSP::transcode :: Failed to guess the format of \"%s\"\n", (from == GUESS ? in : out).c_str()); // print error
+    #endif /*RSP_QUIET_ERRORS*/
+
+    return false;
+  }
+
+  RSP::stream s(in);
+
+  if (s.failed) {
+    #ifndef RSP_QUIET_ERRORS
+    printf("RSP::transcode :: %s \"%s\"\n", s.error.c_str(), in.c_str()); // print error
+    #endif /*RSP_QUIET_ERRORS*/
+
+    return false;
+  }
+
+  FILE *f = fopen(out.c_str(), "wb");
+
+  if (f == NULL) {
+    #ifndef RSP_QUIET_ERRORS
+    printf("RSP::transcode :: Failed to open file \"%s\"\n", out.c_str()); // print error
+    #endif /*RSP_QUIET_ERRORS*/
+
+    return false;
+  }
+
+  bool ok = transcode(s, from, [f](const std::string &str) { fwrite(str.data(), 1, str.size(), f); }, to);
+
+  fclose(f);
+  return ok;
+}
+
+RSP::column &RSP::table::operator[](std::string name) {
+  for (auto &c : columns)
+    if (c.name == name)
+      return c;
+
+  #ifndef RSP_QUIET_ERRORS
+  printf("RSP::table :: Column not found \"%s\"\n", name.c_str()); // print error
+  #endif /*RSP_QUIET_ERRORS*/
+
+  static RSP::column none; // blank column to return
+  none = RSP::column();
+  none.name = "RSP-ERROR";
+
+  return none;
+}
+
+bool RSPisNumber(const std::string &str) { // a JSON number (no leading zeros or +, so ids like 00123 stay strings)
+  return RSPisLiteral(str) && str != "true" && str != "false" && str != "null";
+}
+
+bool RSPparseInt(const std::string &str, int64_t &output) {
+  if (!RSPisNumber(str) || str.find_first_of(".eE") < str.size())
+    return false;
+
+  errno = 0;
+  output = strtoll(str.c_str(), NULL, 10);
+
+  return !errno;
+}
+
+bool RSPparseDouble(const std::string &str, double &output) {
+  if (!RSPisNumber(str))
+    return false;
+
+  output = strtod(str.c_str(), NULL);
+  return true;
+}
+
+bool RSPparseBool(const std::string &str, bool &output) {
+  std::string lower = str;
+  std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+  output = (lower == "true");
+  return output || lower == "false";
+}
+
+RSP::columnType RSPguessType(const std::vector<std::vector<std::string>> &rows, size_t i) { // the narrowest type every value in the column fits
+  bool isInt = true, isDouble = true, isBool = true, any = false;
+  int64_t n;
+  double d;
+  bool b;
+
+  for (auto &row : rows) {
+    if (i >= row.size() || row[i].empty()) // empty cells fit any type
+      continue;
+
+    any = true;
+    isInt = isInt && RSPparseInt(row[i], n);
+    isDouble = isDouble && RSPparseDouble(row[i], d);
+    isBool = isBool && RSPparseBool(row[i], b);
+  }
+
+  if (!any)
+    return RSP::stringColumn;
+
+  return isInt ? RSP::intColumn : isDouble ? RSP::doubleColumn : isBool ? RSP::boolColumn : RSP::stringColumn;
+}
+
+void RSPpromote(RSP::column &col, RSP::columnType t) { // change a column's type (to double or string), converting what's already there
+  if (t == RSP::doubleColumn && col.t == RSP::intColumn) {
+    col.doubles.assign(col.ints.begin(), col.ints.end());
+    col.ints = std::vector<int64_t>();
+  }
+
+  else if (t == RSP::stringColumn) { // the text is already there, as it was in the source
+    col.ints = std::vector<int64_t>();
+    col.doubles = std::vector<double>();
+    col.bools = std::vector<bool>();
+  }
+
+  col.t = t;
+}
+
+void RSPappend(RSP::column &col, const std::string &value) { // add a cell to the end of a column
+  bool null = value.empty();
+  int64_t n = 0;
+  double d = 0;
+  bool b = false;
+
+  if (!null) { // make sure the value fits, or widen the column
+    if (col.t == RSP::intColumn && !RSPparseInt(value, n))
+      RSPpromote(col, RSPparseDouble(value, d) ? RSP::doubleColumn : RSP::stringColumn);
+    if (col.t == RSP::doubleColumn && !RSPparseDouble(value, d))
+      RSPpromote(col, RSP::stringColumn);
+    if (col.t == RSP::boolColumn && !RSPparseBool(value, b))
+      RSPpromote(col, RSP::stringColumn);
+  }
+
+  switch (col.t) {
+    case RSP::intColumn: col.ints.push_back(n); break;
+    case RSP::doubleColumn: col.doubles.push_back(d); break;
+    case RSP::boolColumn: col.bools.push_back(b); break;
+    default: break;
+  }
+
+  if (col.offsets.empty())
+    col.offsets.push_back(0);
+
+  col.chars += value;
+  col.offsets.push_back(col.chars.size());
+  col.nulls.push_back(null);
+}
+
+struct RSPtableBuilder {
+  RSP::table output;
+  size_t sample;
+  bool haveHeader = false, started = false;
+  std::vector<std::string> header;
+  std::vector<std::vector<std::string>> rows; // the first rows, held until the types are guessed
+
+  void start() { // guess the types, then add the rows held so far
+    started = true;
+
+    for (size_t i = 0; i < header.size(); i++) {
+      RSP::column col;
+      col.name = header[i];
+      col.t = RSPguessType(rows, i);
+
+      output.columns.push_back(col);
+    }
+
+    for (auto &row : rows)
+      add(row);
+
+    rows = std::vector<std::vector<std::string>>();
+  }
+
+  void add(std::vector<std::string> &row) {
+    for (size_t i = 0; i < output.columns.size(); i++)
+      RSPappend(output.columns[i], (i < row.size()) ? row[i] : std::string());
+
+    output.rows++;
+  }
+
+  void operator()(std::vector<std::string> &fields, std::vector<bool> &) {
+    if (!haveHeader) {
+      header = fields;
+      haveHeader = true;
+    }
+    else if (!started) {
+      rows.push_back(fields);
+
+      if (rows.size() == sample)
+        start();
+    }
+    else
+      add(fields);
+  }
+
+  RSP::table finish() {
+    if (!started)
+      start();
+
+    for (auto &col : output.columns) { // the types are final, only string columns need their text now
+      if (col.t != RSP::stringColumn) {
+        col.chars = std::string();
+        col.offsets = std::vector<size_t>();
+      }
+    }
+
+    return std::move(output);
+  }
+}; // builds a table from CSV records
+
+RSP::table RSP::loadTableS(std::string data, RSP::format c, size_t sample) {
+  RSPtableBuilder builder;
+  builder.sample = sample ? sample : 1;
+
+  RSPcsvReader reader(c, std::ref(builder));
+
+  reader.read(data.data(), data.size());
+  reader.finish();
+
+  return builder.finish();
+}
+
+RSP::table RSP::loadTableF(std::string file, RSP::format c, size_t sample) {
+  RSP::stream s(file);
+  RSPtableBuilder builder;
+  builder.sample = sample ? sample : 1;
+
+  RSPcsvReader reader(c, std::ref(builder));
+  std::string block;
+
+  while (s.read(block))
+    reader.read(block.data(), block.size());
+
+  reader.finish();
+
+  RSP::table output = builder.finish();
+
+  if (s.failed) {
+    #ifndef RSP_QUIET_ERRORS
+    printf("RSP::loadTableF :: %s \"%s\"\n", s.error.c_str(), file.c_str()); // print error
+    #endif /*RSP_QUIET_ERRORS*/
+
+    output.failed = true;
+    output.error = s.error;
   }
 
   return output;
@@ -8,8 +8,8 @@ int main(){
 
     d.next = {
         {"Bikes", "2"},
-        {"Bike 1", .next = {{"color", "\"red\""}}, .args = {{"test1","\"1\""}, {"test2","\"2\""}, {"test3","\"3\""}}},
-        {"Bike 2", .next = {{"color", "\"blue\""}}}
+        {"Bike 1", .next = {{"color", "red"}}, .args = {{"test1","1"}, {"test2","2"}, {"test3","3"}}},
+        {"Bike 2", .next = {{"color", "blue"}}}
     }; 
 
     RSP::dumpF("data.json", d, RSP::JSON);
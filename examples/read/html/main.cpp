@@ -20,4 +20,11 @@ int main(){
 
     for (auto& arg : d["body"]["img"].args)
         std::cout << arg.first << " : " << arg.second << std::endl;
+
+    std::cout << std::endl << "select(\"body > h2\") :" << std::endl << std::endl;
+
+    RSP::nodeIndex index = RSP::buildIndex(d); // optional, makes repeated queries faster
+
+    for (auto n : RSP::select(index, "body > h2"))
+        std::cout << n->key << " : " << n->value << std::endl;
 }
\ No newline at end of file
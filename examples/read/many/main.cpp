@@ -0,0 +1,24 @@
+#include <iostream>
+
+#define RSP_IMPLEMENTATION
+#include "RSP.hpp"
+
+int main(){
+    std::vector<std::string> files;
+
+    for (int i = 0; i < 100; i++)
+        files.push_back("../json/file.json");
+
+    std::vector<RSP::data> d = RSP::loadMany(files, RSP::JSON, 4); // 4 threads
+
+    std::cout << "loaded " << d.size() << " files" << std::endl;
+
+    for (int i = 0; i < 3; i++)
+        std::cout << i << " : member 1 name : " << d[i]["member 1"]["name"].value << std::endl;
+
+    // or, take each file as it's done
+    auto futures = RSP::loadManyAsync({"../json/file.json", "../csv/file.csv"});
+
+    std::cout << futures[0].get()["version"].value << std::endl;
+    std::cout << futures[1].get().list.size() << std::endl;
+}
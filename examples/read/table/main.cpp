@@ -0,0 +1,23 @@
+#include <iostream>
+
+#define RSP_IMPLEMENTATION
+#include "RSP.hpp"
+
+int main(){
+    RSP::table t = RSP::loadTableF("../csv/file.csv");
+
+    std::cout << t.rows << " rows" << std::endl << std::endl;
+
+    for (auto& c : t.columns)
+        std::cout << c.name << " : " << (c.t == RSP::intColumn ? "int" : c.t == RSP::doubleColumn ? "double" : c.t == RSP::boolColumn ? "bool" : "string") << std::endl;
+
+    // scanning a column only reads that column's buffer
+    double total = 0;
+    for (double length : t["Length"].doubles)
+        total += length;
+
+    std::cout << std::endl << "total length : " << total << std::endl;
+
+    for (size_t i = 0; i < t.rows; i++)
+        std::cout << t["Make"].str(i) << " " << t["Model"].str(i) << " (" << t["Year"].ints[i] << ")" << std::endl;
+}
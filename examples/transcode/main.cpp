@@ -0,0 +1,15 @@
+#include <iostream>
+
+#define RSP_ZLIB // read .gz files
+#define RSP_IMPLEMENTATION
+#include "RSP.hpp"
+
+int main(int argc, char **argv){
+    if (argc < 3) {
+        std::cout << "usage : " << argv[0] << " <input file> <output file>" << std::endl;
+        std::cout << "formats are picked from the file extensions (.csv, .json, .ndjson, .xml, .html, .svg)" << std::endl;
+        return 1;
+    }
+
+    return RSP::transcode(argv[1], argv[2]) ? 0 : 1;
+}